@@ -0,0 +1,1764 @@
+/**
+ * @file bench.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Shared benchmark core used by every front-end (cmain, ccmain, cppmain).
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * Holds the pieces that used to be copy-pasted into each main: the
+ * start/stop handshake, timing helpers, run configuration and result files.
+ * The per-lock measurement loops live in bench_case.h, which is included
+ * once per lock type so that every loop is specialized at compile time.
+ *
+ * Compiles as both C and C++.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // PTHREAD_MUTEX_ADAPTIVE_NP and friends
+#endif
+
+#include <time.h>
+#include "meb_print.h"
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <signal.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <sys/utsname.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include "bench_hist.h"
+#include "bench_perf.h"
+#include "bench_bin.h"
+#include "spinlock.h"
+#include "bench_topo.h"
+#include "bench_workload.h"
+#include "bench_clock.h"
+#include "bench_select.h"
+
+#ifndef TRIG_TIMEOUT
+#define TRIG_TIMEOUT 1
+#endif
+#ifndef TRIALS
+#define TRIALS 32
+#endif
+#ifndef SWEEP_TRIALS
+#define SWEEP_TRIALS 4
+#endif
+#ifndef CL_THREADS
+#define CL_THREADS 2
+#endif
+#ifndef CL_TRIALS
+#define CL_TRIALS 4
+#endif
+#ifndef BENCH_CACHELINE
+#define BENCH_CACHELINE 64 // std::hardware_destructive_interference_size on x86-64 and most ARM
+#endif
+#ifndef SL_ITERATIONS
+#define SL_ITERATIONS (INT_MAX / 1000)
+#endif
+#ifndef ADAPT_WIDTH
+#define ADAPT_WIDTH 0.05 // adaptive mode: target width of the 95% confidence interval, relative to the mean
+#endif
+#ifndef ADAPT_BUDGET
+#define ADAPT_BUDGET 10 // adaptive mode: seconds per case and thread count before giving up on the target
+#endif
+#ifndef ADAPT_MIN_TRIALS
+#define ADAPT_MIN_TRIALS 3
+#endif
+#ifndef ADAPT_MAX_TRIALS
+#define ADAPT_MAX_TRIALS 100
+#endif
+#ifndef ADAPT_CAL_NS
+#define ADAPT_CAL_NS 20000000 // adaptive mode: length of the calibration trial
+#endif
+#ifndef ADAPT_MIN_NS
+#define ADAPT_MIN_NS 10000000 // adaptive mode: shortest trial
+#endif
+#ifndef ADAPT_MIN_OPS
+#define ADAPT_MIN_OPS 100000 // adaptive mode: operations a trial should cover, if the duration allows
+#endif
+#ifndef DEPTH_OPS
+#define DEPTH_OPS (1 << 22) // re-locks timed at each depth of the recursion-depth sweep
+#endif
+
+// not every front-end runs every case generated for its locks
+#define BENCH_UNUSED __attribute__((unused))
+
+/**
+ * @brief Run configuration, filled in by bench_init(). The compile-time
+ * settings above are the defaults of the matching fields.
+ */
+struct bench_config
+{
+    char fname[512];  // program name, e.g. cmain.c
+    char prefix[512]; // result file prefix, e.g. cmain
+    int sweep;        // run the contended cases at 1..N threads, with sweep_trials trials each
+    int nthreads;     // thread counts to run the contended cases at, 0 for each case's own
+    int threads[BENCH_COUNTS_MAX];
+    int max_threads;  // largest of threads
+    double trig_timeout; // seconds per timed trial, TRIG_TIMEOUT
+    int trials;          // TRIALS
+    int sweep_trials;    // SWEEP_TRIALS
+    int cl_threads;      // CL_THREADS
+    int cl_trials;       // CL_TRIALS
+    uint64_t sl_iterations; // SL_ITERATIONS
+    int latency;      // time every operation into per-thread histograms
+    int fair;         // time every contended acquisition for the fairness report
+    int layout;       // enum bench_layout_kind used for every trial
+    int layout_study; // run contended cases in both layouts and compare
+    int trial_layout; // enum bench_layout_kind of the trial being run
+    int procs;        // run the process-shared cases
+    int adaptive;     // size trials by calibration and stop once the mean has converged
+    double adapt_width;  // target relative width of the 95% confidence interval
+    double adapt_budget; // seconds per case and thread count
+    uint64_t trial_ns;   // length of the trial being run, 0 for trig_timeout seconds
+    int clock;           // enum bench_clock_source asked for
+    int trial_procs;  // the workers of the trial being run are forked processes
+    int rl_quiet;     // remote-lock trials being run only print, e.g. the atomic baselines
+    int ul_quiet;     // lock/unlock runs being run only print, e.g. the mutex matrix cells
+    int bin;          // also write every trial to <prefix>_<time>.bench
+    int nplaces;      // placement profiles to run contended cases under, 0 to leave threads unpinned
+    int place;        // index into places of the trial being run, -1 for unpinned
+    struct bench_place places[BENCH_NPLACES];
+    cpu_set_t affinity; // the main thread's affinity at start-up
+    struct timespec start;
+};
+
+/**
+ * @brief Result files, opened on first use.
+ */
+struct bench_files
+{
+    FILE *rl;
+    FILE *rl_sweep;
+    FILE *sl_locks;
+    FILE *sl_unlocks;
+    FILE *ul;
+    FILE *cl;
+    FILE *rw;
+    FILE *tl;
+    FILE *tl_overshoot;
+    FILE *pp;
+    FILE *perf;
+    FILE *fair;
+    FILE *mutex;
+    FILE *procs;
+    FILE *depth;
+    FILE *adapt;
+    FILE *atomic;
+    FILE *wake;
+    FILE *layout;
+    FILE *skew;
+    FILE *lat;
+    FILE *topo;
+    FILE *bin;
+};
+
+/**
+ * @brief Operations that get their own latency histogram.
+ */
+enum bench_op
+{
+    BENCH_OP_LOCK,
+    BENCH_OP_TRYLOCK,
+    BENCH_OP_UNLOCK,
+    BENCH_NOPS
+};
+
+static const char *const bench_op_names[BENCH_NOPS] = {"lock", "trylock", "unlock"};
+
+/**
+ * @brief Where the lock, the ready/go/done flags and the per-thread counters
+ * of a trial are placed relative to each other.
+ */
+enum bench_layout_kind
+{
+    BENCH_LAYOUT_ISOLATED, // each on its own cache line
+    BENCH_LAYOUT_PACKED,   // back to back, sharing cache lines
+};
+
+/**
+ * @brief Memory shared by the main thread and the workers during a trial.
+ *
+ * When the workers are processes, mem is a shared mapping that also holds
+ * a copy of each worker's results, and of its histograms, for the main
+ * process to collect.
+ */
+struct bench_layout
+{
+    void *mem;
+    void *lock;
+    int *ready; // workers that reached the start line
+    int *go;    // start signal
+    int *done;  // stop signal
+    size_t size;
+    int procs;                  // workers are forked processes
+    pid_t *pids;                // procs only
+    struct bench_thread *ret;   // procs only, one per worker
+    struct bench_hist *ret_hist; // procs only, BENCH_NOPS per worker
+};
+
+/**
+ * @brief Per-thread state handed to a worker.
+ */
+struct bench_thread
+{
+    const char *name; // case, for the one-thread cases that report from the worker
+    void *lock;
+    int *ready;
+    int *go;
+    int *done;
+    uint64_t *counter; // published every iteration, placed by bench_layout_init()
+    uint64_t count;
+    uint64_t writes; // reader-writer cases: how many of count were writes
+    uint64_t torn;   // reader-writer cases: reads that saw a half-written value
+    uint64_t max_wait; // fairness: longest lock() call, ns
+    uint64_t max_gap;  // fairness: longest time without the lock, ns
+    struct timespec start;
+    struct timespec diff;
+    struct timespec cpu;     // thread CPU time spent inside the timed window
+    struct bench_hist *hist; // BENCH_NOPS histograms, only used in latency mode
+    struct bench_perf perf;  // event counts over the timed window, only used in perf mode
+};
+
+/**
+ * @brief Spread of the workers' start and stop times over a set of trials.
+ */
+struct bench_skew
+{
+    int trials;
+    double start_sum; // ns
+    double start_max;
+    double stop_sum;
+    double stop_max;
+};
+
+/**
+ * @brief Mean throughput and CPU burn of a contended-lock run.
+ */
+struct bench_rate
+{
+    double ops; // aggregate acquisitions per second
+    double cpu; // CPU seconds burned per wall-clock second, summed over threads
+};
+
+static struct bench_config bench_cfg;
+static struct bench_files bench_out;
+
+static inline void get_current_fname(const char *path, char *ret)
+{
+    if (ret == NULL)
+        return;
+    char *tmp = (char *)malloc(strlen(path) + 1);
+    if (tmp == NULL)
+        return;
+    strcpy(tmp, path);
+    char *tok = strtok(tmp, "/");
+    dbprintlf("%s", tok);
+    while (tok != NULL)
+    {
+        strcpy(ret, tok);
+        tok = strtok(NULL, "/");
+    }
+    free(tmp);
+}
+
+static inline void timespec_diff(struct timespec *start, struct timespec *stop,
+                                 struct timespec *result)
+{
+    if ((stop->tv_nsec - start->tv_nsec) < 0)
+    {
+        result->tv_sec = stop->tv_sec - start->tv_sec - 1;
+        result->tv_nsec = stop->tv_nsec - start->tv_nsec + 1000000000L;
+    }
+    else
+    {
+        result->tv_sec = stop->tv_sec - start->tv_sec;
+        result->tv_nsec = stop->tv_nsec - start->tv_nsec;
+    }
+
+    return;
+}
+
+static inline double timespec_sec(const struct timespec *ts)
+{
+    return ts->tv_sec + ts->tv_nsec * 1e-9;
+}
+
+static inline size_t bench_round_up(size_t v, size_t to)
+{
+    return (v + to - 1) / to * to;
+}
+
+/**
+ * @brief Maps size bytes of zeroed memory from a POSIX shared memory
+ * object, shared with every process forked afterwards. The object is
+ * unlinked right away, so it goes when the last mapping does.
+ */
+static inline void *bench_shm_alloc(size_t size)
+{
+    static unsigned seq = 0;
+    char path[64];
+    snprintf(path, sizeof(path), "/mutex_timed_test.%d.%u", (int)getpid(), seq++);
+    int fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+    {
+        dbprintlf(FATAL "Failed to create shared memory object %s: %s", path, strerror(errno));
+        exit(4);
+    }
+    shm_unlink(path);
+    void *mem = ftruncate(fd, (off_t)size) == 0 ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mem == MAP_FAILED)
+    {
+        dbprintlf(FATAL "Failed to map %zu bytes of shared memory: %s", size, strerror(errno));
+        exit(4);
+    }
+    return mem;
+}
+
+static inline void bench_shm_free(void *mem, size_t size)
+{
+    munmap(mem, size);
+}
+
+/**
+ * @brief Allocates the shared memory of a trial and points the n workers'
+ * lock, flags and counters into it. With bench_cfg.trial_procs set, it is
+ * shared memory (bench_shm_alloc()) for workers started as processes.
+ *
+ * The lock itself is not initialized here; lay->lock is raw storage of
+ * lock_size bytes at cache-line alignment.
+ */
+static inline void bench_layout_init(struct bench_layout *lay, int kind, size_t lock_size, struct bench_thread *thr, int n)
+{
+    size_t ready_off, go_off, done_off, count_off, count_stride;
+    if (kind == BENCH_LAYOUT_PACKED)
+    {
+        ready_off = bench_round_up(lock_size, sizeof(int));
+        go_off = ready_off + sizeof(int);
+        done_off = go_off + sizeof(int);
+        count_off = bench_round_up(done_off + sizeof(int), sizeof(uint64_t));
+        count_stride = sizeof(uint64_t);
+    }
+    else
+    {
+        ready_off = bench_round_up(lock_size, BENCH_CACHELINE);
+        go_off = ready_off + BENCH_CACHELINE;
+        done_off = go_off + BENCH_CACHELINE;
+        count_off = done_off + BENCH_CACHELINE;
+        count_stride = BENCH_CACHELINE;
+    }
+
+    size_t size = bench_round_up(count_off + n * count_stride, BENCH_CACHELINE);
+    size_t ret_off = size, hist_off = bench_round_up(ret_off + n * sizeof(struct bench_thread), BENCH_CACHELINE);
+    lay->procs = bench_cfg.trial_procs;
+    lay->pids = NULL;
+    lay->ret = NULL;
+    lay->ret_hist = NULL;
+    if (lay->procs)
+    {
+        size = hist_off + n * BENCH_NOPS * sizeof(struct bench_hist);
+        lay->mem = bench_shm_alloc(size);
+        lay->pids = (pid_t *)calloc(n, sizeof(pid_t));
+        if (lay->pids == NULL)
+        {
+            dbprintlf(FATAL "Failed to allocate %d worker processes.", n);
+            exit(4);
+        }
+        lay->ret = (struct bench_thread *)((char *)lay->mem + ret_off);
+        lay->ret_hist = (struct bench_hist *)((char *)lay->mem + hist_off);
+    }
+    else if (posix_memalign(&lay->mem, BENCH_CACHELINE, size) != 0)
+    {
+        dbprintlf(FATAL "Failed to allocate %zu bytes of shared state.", size);
+        exit(4);
+    }
+    else
+    {
+        memset(lay->mem, 0, size);
+    }
+    lay->size = size;
+
+    char *base = (char *)lay->mem;
+    lay->lock = base;
+    lay->ready = (int *)(base + ready_off);
+    lay->go = (int *)(base + go_off);
+    lay->done = (int *)(base + done_off);
+    for (int j = 0; j < n; j++)
+    {
+        thr[j].lock = lay->lock;
+        thr[j].ready = lay->ready;
+        thr[j].go = lay->go;
+        thr[j].done = lay->done;
+        thr[j].counter = (uint64_t *)(base + count_off + j * count_stride);
+    }
+}
+
+static inline void bench_layout_free(struct bench_layout *lay)
+{
+    if (lay->procs)
+    {
+        bench_shm_free(lay->mem, lay->size);
+        free(lay->pids);
+        lay->pids = NULL;
+    }
+    else
+    {
+        free(lay->mem);
+    }
+    lay->mem = NULL;
+}
+
+static inline const char *bench_layout_name(int kind)
+{
+    return kind == BENCH_LAYOUT_PACKED ? "packed" : "isolated";
+}
+
+/**
+ * @brief Worker side of the start line: check in, then wait for the go.
+ *
+ * The release on check-in pairs with bench_wait_ready(); the acquire on go
+ * pairs with bench_go(), so everything the main thread set up before the
+ * go (e.g. taking the lock) is visible to every worker once it starts.
+ */
+static inline void bench_start_line(struct bench_thread *arg)
+{
+    __atomic_fetch_add(arg->ready, 1, __ATOMIC_RELEASE);
+    while (!__atomic_load_n(arg->go, __ATOMIC_ACQUIRE))
+        cpu_relax();
+}
+
+static inline int bench_stopped(const int *done)
+{
+    return __atomic_load_n(done, __ATOMIC_ACQUIRE);
+}
+
+static inline void bench_wait_ready(struct bench_layout *lay, int n)
+{
+    while (__atomic_load_n(lay->ready, __ATOMIC_ACQUIRE) < n)
+        cpu_relax();
+}
+
+static inline void bench_go(struct bench_layout *lay)
+{
+    __atomic_store_n(lay->go, 1, __ATOMIC_RELEASE);
+}
+
+static inline void bench_stop(struct bench_layout *lay)
+{
+    __atomic_store_n(lay->done, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Lets a trial run for its length: bench_cfg.trial_ns, or
+ * bench_cfg.trig_timeout seconds.
+ */
+static inline void bench_trial_sleep(void)
+{
+    uint64_t ns = bench_cfg.trial_ns != 0 ? bench_cfg.trial_ns : (uint64_t)(bench_cfg.trig_timeout * 1e9);
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
+}
+
+/**
+ * @brief The placement profile of the trial being run, or NULL if unpinned.
+ */
+static inline const struct bench_place *bench_place_current(void)
+{
+    return bench_cfg.place < 0 ? NULL : &bench_cfg.places[bench_cfg.place];
+}
+
+/**
+ * @brief Pins the thread created with attr to its CPU in the current
+ * profile. Slot 0 is the main thread, slot j + 1 worker j.
+ */
+static inline void bench_place_attr(pthread_attr_t *attr, int slot)
+{
+    const struct bench_place *p = bench_place_current();
+    if (p == NULL)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(bench_place_cpu(p, slot), &set);
+    pthread_attr_setaffinity_np(attr, sizeof(set), &set);
+}
+
+/**
+ * @brief Pins the calling thread to its slot in the current profile.
+ */
+static inline void bench_place_self(int slot)
+{
+    const struct bench_place *p = bench_place_current();
+    if (p == NULL)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(bench_place_cpu(p, slot), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/**
+ * @brief Pins the main thread to slot 0 of the current profile.
+ */
+static inline void bench_place_enter(void)
+{
+    bench_place_self(0);
+}
+
+/**
+ * @brief Gives the main thread back the affinity it started with.
+ */
+static inline void bench_place_leave(void)
+{
+    if (bench_place_current() != NULL)
+        pthread_setaffinity_np(pthread_self(), sizeof(bench_cfg.affinity), &bench_cfg.affinity);
+}
+
+/**
+ * @brief Starts worker j on fcn(&thr[j]), as a thread pinned to slot j + 1,
+ * or, if the trial's workers are processes, as a forked process that pins
+ * itself and then leaves its results in lay for bench_join().
+ *
+ * Pending output is flushed first so that the child does not inherit it.
+ */
+static inline void bench_spawn(struct bench_layout *lay, void *(*fcn)(void *), struct bench_thread *thr, pthread_t *threads, int j)
+{
+    if (!lay->procs)
+    {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        bench_place_attr(&attr, j + 1);
+        pthread_create(&threads[j], &attr, fcn, &thr[j]);
+        pthread_attr_destroy(&attr);
+        return;
+    }
+
+    meb_flush();
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        dbprintlf(FATAL "Failed to fork worker %d: %s", j, strerror(errno));
+        exit(4);
+    }
+    if (pid == 0)
+    {
+        bench_place_self(j + 1);
+        fcn(&thr[j]);
+        lay->ret[j] = thr[j];
+        if (thr[j].hist != NULL)
+            memcpy(&lay->ret_hist[j * BENCH_NOPS], thr[j].hist, BENCH_NOPS * sizeof(struct bench_hist));
+        _exit(0);
+    }
+    lay->pids[j] = pid;
+}
+
+/**
+ * @brief Waits for worker j and, if it was a process, copies its results
+ * and histograms back into thr[j].
+ */
+static inline void bench_join(struct bench_layout *lay, struct bench_thread *thr, pthread_t *threads, int j)
+{
+    if (!lay->procs)
+    {
+        pthread_join(threads[j], NULL);
+        return;
+    }
+
+    int status;
+    if (waitpid(lay->pids[j], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        dbprintlf(FATAL "Worker process %d failed.", (int)lay->pids[j]);
+        exit(4);
+    }
+    struct bench_hist *hist = thr[j].hist;
+    thr[j] = lay->ret[j];
+    thr[j].hist = hist;
+    if (hist != NULL)
+        memcpy(hist, &lay->ret_hist[j * BENCH_NOPS], BENCH_NOPS * sizeof(struct bench_hist));
+}
+
+#ifdef __cplusplus
+#include <new>
+template <typename T>
+static inline T *bench_construct(void *p) { return new (p) T; }
+template <typename T>
+static inline void bench_destruct(T *p) { p->~T(); }
+#define BENCH_NEW(T, p) bench_construct<T>(p)
+#define BENCH_DELETE(T, p) bench_destruct<T>(p)
+#else
+#define BENCH_NEW(T, p) ((T *)(p))
+#define BENCH_DELETE(T, p) ((void)(p))
+#endif // __cplusplus
+
+/**
+ * @brief Opens <prefix>_<name>.data for appending, exiting on failure.
+ */
+static inline FILE *bench_fopen(FILE **fp, const char *name)
+{
+    if (*fp == NULL)
+    {
+        char path[600];
+        snprintf(path, sizeof(path), "%s_%s.data", bench_cfg.prefix, name);
+        *fp = fopen(path, "a");
+        if (*fp == NULL)
+        {
+            dbprintlf(FATAL "Failed to open %s.", path);
+            exit(1);
+        }
+    }
+    return *fp;
+}
+
+static inline uint64_t timespec_ns(const struct timespec *ts)
+{
+    return (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+/**
+ * @brief Creates <prefix>_<start time>.bench and writes its header.
+ */
+static inline void bench_bin_init(int argc, char *argv[])
+{
+    char path[600], stamp[32];
+    struct tm tm;
+    localtime_r(&bench_cfg.start.tv_sec, &tm);
+    strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &tm);
+    snprintf(path, sizeof(path), "%s_%s.bench", bench_cfg.prefix, stamp);
+    bench_out.bin = fopen(path, "wb");
+    if (bench_out.bin == NULL)
+    {
+        dbprintlf(FATAL "Failed to open %s.", path);
+        exit(1);
+    }
+
+    struct bench_bin_header h;
+    struct utsname u;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, BENCH_BIN_MAGIC, sizeof(h.magic));
+    h.version = BENCH_BIN_VERSION;
+    h.endian = BENCH_BIN_ENDIAN;
+    h.header_size = sizeof(h);
+    h.block_header_size = sizeof(struct bench_bin_block);
+    h.start_ns = timespec_ns(&bench_cfg.start);
+    h.ncpus = (int32_t)sysconf(_SC_NPROCESSORS_ONLN);
+    h.trial_ms = (int32_t)(bench_cfg.trig_timeout * 1000 + 0.5);
+    h.trials = bench_cfg.trials;
+    h.sweep_trials = bench_cfg.sweep_trials;
+    h.cl_threads = bench_cfg.cl_threads;
+    h.cl_trials = bench_cfg.cl_trials;
+    if (uname(&u) == 0)
+    {
+        snprintf(h.host, sizeof(h.host), "%s", u.nodename);
+        snprintf(h.kernel, sizeof(h.kernel), "%s %s %s", u.sysname, u.release, u.version);
+        snprintf(h.machine, sizeof(h.machine), "%s", u.machine);
+    }
+#if defined(__clang__)
+    const char *cc = "clang " __clang_version__;
+#elif defined(__GNUC__)
+    const char *cc = "gcc " __VERSION__;
+#else
+    const char *cc = "unknown";
+#endif
+#ifdef __cplusplus
+    snprintf(h.compiler, sizeof(h.compiler), "%s, C++ %ld", cc, (long)__cplusplus);
+#else
+    snprintf(h.compiler, sizeof(h.compiler), "%s, C %ld", cc, (long)__STDC_VERSION__);
+#endif
+    snprintf(h.program, sizeof(h.program), "%.*s", (int)sizeof(h.program) - 1, bench_cfg.fname);
+    for (int i = 1, len = 0; i < argc && len < (int)sizeof(h.args); i++)
+        len += snprintf(h.args + len, sizeof(h.args) - len, i > 1 ? " %s" : "%s", argv[i]);
+
+    if (fwrite(&h, sizeof(h), 1, bench_out.bin) != 1)
+    {
+        dbprintlf(FATAL "Failed to write %s.", path);
+        exit(1);
+    }
+    bprintlf(GREEN_FG "Binary results: %s", path);
+}
+
+/**
+ * @brief Fills in the run state shared by every block and writes it.
+ */
+static inline void bench_bin_emit(struct bench_bin_block *b, const void *const *cols)
+{
+    b->layout = bench_cfg.trial_layout;
+    b->place = bench_cfg.place >= 0 ? bench_cfg.places[bench_cfg.place].kind : -1;
+    if (bench_bin_block_write(bench_out.bin, b, cols) != 0)
+    {
+        dbprintlf(FATAL "Failed to write binary results.");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Writes one row per worker of a contended trial: its index, count,
+ * start time, wall-clock and CPU time in the timed window, and how many of
+ * its operations were writes (reader-writer cases only).
+ */
+static inline void bench_bin_trial(const char *name, const char *kind, const struct bench_thread *thr, int n)
+{
+    if (!bench_cfg.bin)
+        return;
+    uint64_t *v = (uint64_t *)calloc(6 * n, sizeof(uint64_t));
+    if (v == NULL)
+        return;
+    for (int j = 0; j < n; j++)
+    {
+        v[j] = j;
+        v[n + j] = thr[j].count;
+        v[2 * n + j] = timespec_ns(&thr[j].start);
+        v[3 * n + j] = timespec_ns(&thr[j].diff);
+        v[4 * n + j] = timespec_ns(&thr[j].cpu);
+        v[5 * n + j] = thr[j].writes;
+    }
+    struct bench_bin_block b;
+    const void *cols[] = {v, v + n, v + 2 * n, v + 3 * n, v + 4 * n, v + 5 * n};
+    bench_bin_block_init(&b, name, kind, n, n);
+    bench_bin_block_col(&b, "thread", BENCH_BIN_U64);
+    bench_bin_block_col(&b, "count", BENCH_BIN_U64);
+    bench_bin_block_col(&b, "start_ns", BENCH_BIN_U64);
+    bench_bin_block_col(&b, "wall_ns", BENCH_BIN_U64);
+    bench_bin_block_col(&b, "cpu_ns", BENCH_BIN_U64);
+    bench_bin_block_col(&b, "writes", BENCH_BIN_U64);
+    bench_bin_emit(&b, cols);
+    free(v);
+}
+
+/**
+ * @brief Writes the single row of a one-thread run: count, start time and
+ * wall-clock time.
+ */
+static inline void bench_bin_solo(const char *name, const char *kind, uint64_t count, const struct timespec *start, const struct timespec *diff)
+{
+    if (!bench_cfg.bin)
+        return;
+    uint64_t start_ns = timespec_ns(start), wall_ns = timespec_ns(diff);
+    struct bench_bin_block b;
+    const void *cols[] = {&count, &start_ns, &wall_ns};
+    bench_bin_block_init(&b, name, kind, 1, 1);
+    bench_bin_block_col(&b, "count", BENCH_BIN_U64);
+    bench_bin_block_col(&b, "start_ns", BENCH_BIN_U64);
+    bench_bin_block_col(&b, "wall_ns", BENCH_BIN_U64);
+    bench_bin_emit(&b, cols);
+}
+
+/**
+ * @brief Writes the non-empty buckets of a histogram, one row per bucket:
+ * its upper bound (in unit, which names the column) and its sample count.
+ */
+static inline void bench_bin_buckets(const char *name, const char *kind, const char *unit, int n, const struct bench_hist *h)
+{
+    if (!bench_cfg.bin)
+        return;
+    uint64_t *v = (uint64_t *)malloc(2 * BENCH_HIST_BUCKETS * sizeof(uint64_t));
+    if (v == NULL)
+        return;
+    uint64_t rows = 0;
+    for (int i = 0; i < BENCH_HIST_BUCKETS; i++)
+    {
+        if (h->buckets[i] == 0)
+            continue;
+        v[rows] = bench_hist_value(i);
+        v[BENCH_HIST_BUCKETS + rows] = h->buckets[i];
+        rows++;
+    }
+    struct bench_bin_block b;
+    const void *cols[] = {v, v + BENCH_HIST_BUCKETS};
+    bench_bin_block_init(&b, name, kind, n, rows);
+    bench_bin_block_col(&b, unit, BENCH_BIN_U64);
+    bench_bin_block_col(&b, "samples", BENCH_BIN_U64);
+    bench_bin_emit(&b, cols);
+    free(v);
+}
+
+/**
+ * @brief Writes a merged latency histogram of op, in ns.
+ */
+static inline void bench_bin_hist(const char *name, int op, int n, const struct bench_hist *h)
+{
+    char kind[16];
+    snprintf(kind, sizeof(kind), "lat_%s", bench_op_names[op]);
+    bench_bin_buckets(name, kind, "ns", n, h);
+}
+
+/**
+ * @brief Prints the command-line arguments.
+ */
+static inline void bench_usage(const char *prog)
+{
+    printf("Usage: %s [ARG]...\n"
+           "\n"
+           "What to run:\n"
+           "  only KIND[:NAME][,...]  run only matching cases; KIND and NAME are fnmatch(3) patterns,\n"
+           "                          KIND one of rl sl depth ul cl rw tl pp mutex xp atomic wake; repeatable\n"
+           "  list                    print the selected cases as KIND:NAME and exit\n"
+           "  procs                   also run the process-shared cases (CASE TEN)\n"
+           "\n"
+           "How long and how wide:\n"
+           "  duration SEC            seconds per timed trial (default %g)\n"
+           "  trials N                trials per case and thread count (default %d, %d contended, %d in sweep mode)\n"
+           "  iters N                 operations per one-thread trial (default %" PRIu64 ")\n"
+           "  threads LIST            run contended cases at each thread count in LIST, e.g. 1,2,4,8 or 1-4,8\n"
+           "  sweep [N]               run contended cases at 1..N threads (default N: online CPUs), skip one-thread cases\n"
+           "  adaptive [WIDTH%%]       size trials by calibration, stop at a 95%% CI of WIDTH%% (default %g)\n"
+           "  budget SEC              adaptive time budget per case and thread count (default %g)\n"
+           "\n"
+           "What to measure:\n"
+           "  latency | fair | perf   per-operation histograms, fairness, performance counters\n"
+           "  cs SPEC | think SPEC    critical-section and think-time lengths: N, exp:N or trace:FILE (ns)\n"
+           "  lines N                 shared cache lines written under the lock\n"
+           "  packed | padding        pack the lock with the flags, or compare both layouts\n"
+           "  pin [PROFILES]          pin threads per placement profile: smt, l3, xl3, numa\n"
+           "  clock tsc|raw           interval timer (default tsc)\n"
+           "\n"
+           "Output:\n"
+           "  out PREFIX              write results to PREFIX_<name>.data (default %s)\n"
+           "  bin                     also write every trial to PREFIX_<time>.bench\n"
+           "  help                    print this and exit\n",
+           prog, (double)TRIG_TIMEOUT, TRIALS, CL_TRIALS, SWEEP_TRIALS, (uint64_t)SL_ITERATIONS, ADAPT_WIDTH * 100, (double)ADAPT_BUDGET, bench_cfg.prefix);
+}
+
+/**
+ * @brief Parses the command line and records the program start time. Bad
+ * arguments are fatal, so a scripted run never goes ahead with a setting
+ * other than the one asked for.
+ *
+ * @param file __FILE__ of the front-end, used to name the result files.
+ */
+static inline void bench_init(int argc, char *argv[], const char *file)
+{
+    memset(&bench_cfg, 0, sizeof(bench_cfg));
+    get_current_fname(file, bench_cfg.fname);
+    strcpy(bench_cfg.prefix, bench_cfg.fname);
+    char *ext = strrchr(bench_cfg.prefix, '.');
+    if (ext != NULL)
+        *ext = '\0';
+
+    unsigned places = 0;
+    int perf = 0, workload = 0;
+    bench_cfg.max_threads = 1;
+    bench_cfg.trig_timeout = TRIG_TIMEOUT;
+    bench_cfg.trials = TRIALS;
+    bench_cfg.sweep_trials = SWEEP_TRIALS;
+    bench_cfg.cl_threads = CL_THREADS;
+    bench_cfg.cl_trials = CL_TRIALS;
+    bench_cfg.sl_iterations = SL_ITERATIONS;
+    bench_cfg.adapt_width = ADAPT_WIDTH;
+    bench_cfg.adapt_budget = ADAPT_BUDGET;
+    bench_cfg.clock = BENCH_CLOCK_TSC;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "sweep") == 0)
+        {
+            long n = sysconf(_SC_NPROCESSORS_ONLN);
+            if (i + 1 < argc && bench_long_parse(argv[i + 1], &n) == 0)
+            {
+                if (n < 1 || n > BENCH_COUNTS_MAX)
+                {
+                    dbprintlf(FATAL "Bad sweep width: %s (want 1 to %d threads).", argv[i + 1], BENCH_COUNTS_MAX);
+                    exit(1);
+                }
+                i++;
+            }
+            else if (n > BENCH_COUNTS_MAX) // more online CPUs than a sweep holds
+            {
+                n = BENCH_COUNTS_MAX;
+            }
+            bench_cfg.sweep = 1;
+            bench_cfg.nthreads = n > 1 ? (int)n : 1;
+            for (int k = 0; k < bench_cfg.nthreads; k++)
+                bench_cfg.threads[k] = k + 1;
+        }
+        else if (strcmp(argv[i], "threads") == 0 && i + 1 < argc)
+        {
+            if ((bench_cfg.nthreads = bench_counts_parse(argv[++i], bench_cfg.threads, BENCH_COUNTS_MAX)) < 0)
+            {
+                dbprintlf(FATAL "Bad thread counts: %s (want e.g. 1,2,4,8 or 1-4, at most %d).", argv[i], BENCH_COUNTS_MAX);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "duration") == 0 && i + 1 < argc)
+        {
+            if (bench_double_parse(argv[++i], &bench_cfg.trig_timeout) != 0 || bench_cfg.trig_timeout <= 0)
+            {
+                dbprintlf(FATAL "Bad duration: %s (want seconds > 0).", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "trials") == 0 && i + 1 < argc)
+        {
+            long n;
+            if (bench_long_parse(argv[++i], &n) != 0 || n < 1 || n > INT_MAX)
+            {
+                dbprintlf(FATAL "Bad trial count: %s (want a count >= 1).", argv[i]);
+                exit(1);
+            }
+            bench_cfg.trials = (int)n;
+            bench_cfg.sweep_trials = bench_cfg.cl_trials = bench_cfg.trials;
+        }
+        else if (strcmp(argv[i], "iters") == 0 && i + 1 < argc)
+        {
+            if (bench_u64_parse(argv[++i], &bench_cfg.sl_iterations) != 0 || bench_cfg.sl_iterations == 0)
+            {
+                dbprintlf(FATAL "Bad iteration count: %s (want a count >= 1).", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "out") == 0 && i + 1 < argc)
+        {
+            snprintf(bench_cfg.prefix, sizeof(bench_cfg.prefix), "%s", argv[++i]);
+        }
+        else if (strcmp(argv[i], "only") == 0 && i + 1 < argc)
+        {
+            if (bench_select_parse(argv[++i]) != 0)
+            {
+                dbprintlf(FATAL "Bad filter: %s (want KIND[:NAME], KIND matching one of rl sl depth ul cl rw tl pp mutex xp atomic wake).", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "list") == 0)
+        {
+            bench_sel.list = 1;
+        }
+        else if (strcmp(argv[i], "help") == 0 || strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0)
+        {
+            bench_usage(argv[0]);
+            exit(0);
+        }
+        else if (strcmp(argv[i], "latency") == 0)
+        {
+            bench_cfg.latency = 1;
+        }
+        else if (strcmp(argv[i], "perf") == 0)
+        {
+            perf = 1;
+        }
+        else if (strcmp(argv[i], "fair") == 0)
+        {
+            bench_cfg.fair = 1;
+        }
+        else if ((strcmp(argv[i], "cs") == 0 || strcmp(argv[i], "think") == 0) && i + 1 < argc)
+        {
+            struct bench_dist *d = argv[i][0] == 'c' ? &bench_wl.cs : &bench_wl.think;
+            if (bench_dist_parse(d, argv[++i]) != 0)
+            {
+                dbprintlf(FATAL "Bad %s length: %s (want N, exp:N or trace:FILE, in ns).", argv[i - 1], argv[i]);
+                exit(1);
+            }
+            workload = 1;
+        }
+        else if (strcmp(argv[i], "lines") == 0 && i + 1 < argc)
+        {
+            long n;
+            if (bench_long_parse(argv[++i], &n) != 0 || n < 0 || n > INT_MAX / 64)
+            {
+                dbprintlf(FATAL "Bad line count: %s (want a count >= 0).", argv[i]);
+                exit(1);
+            }
+            bench_wl.lines = (int)n;
+            workload = 1;
+        }
+        else if (strcmp(argv[i], "packed") == 0)
+        {
+            bench_cfg.layout = BENCH_LAYOUT_PACKED;
+        }
+        else if (strcmp(argv[i], "padding") == 0)
+        {
+            bench_cfg.layout_study = 1;
+        }
+        else if (strcmp(argv[i], "adaptive") == 0)
+        {
+            double width;
+            bench_cfg.adaptive = 1;
+            if (i + 1 < argc && bench_double_parse(argv[i + 1], &width) == 0)
+            {
+                if (width <= 0)
+                {
+                    dbprintlf(FATAL "Bad adaptive target: %s (want a percentage > 0).", argv[i + 1]);
+                    exit(1);
+                }
+                bench_cfg.adapt_width = width / 100;
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "budget") == 0 && i + 1 < argc)
+        {
+            if (bench_double_parse(argv[++i], &bench_cfg.adapt_budget) != 0 || bench_cfg.adapt_budget <= 0)
+            {
+                dbprintlf(FATAL "Bad budget: %s (want seconds > 0).", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "clock") == 0 && i + 1 < argc)
+        {
+            if ((bench_cfg.clock = bench_clock_parse(argv[++i])) < 0)
+            {
+                dbprintlf(FATAL "Bad clock: %s (want tsc or raw).", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "procs") == 0)
+        {
+            bench_cfg.procs = 1;
+        }
+        else if (strcmp(argv[i], "bin") == 0)
+        {
+            bench_cfg.bin = 1;
+        }
+        else if (strcmp(argv[i], "pin") == 0)
+        {
+            if (i + 1 < argc && bench_place_parse(argv[i + 1]) != 0)
+                places = bench_place_parse(argv[++i]);
+            else
+                places = (1u << BENCH_NPLACES) - 1;
+        }
+        else
+        {
+            dbprintlf(FATAL "Unknown or incomplete argument: %s (see help).", argv[i]);
+            exit(1);
+        }
+    }
+    for (int k = 0; k < bench_cfg.nthreads; k++)
+        if (bench_cfg.threads[k] > bench_cfg.max_threads)
+            bench_cfg.max_threads = bench_cfg.threads[k];
+
+    clock_gettime(CLOCK_REALTIME, &bench_cfg.start);
+    if (bench_sel.list)
+        return;
+    bprintlf(GREEN_FG "Program: %s", bench_cfg.fname);
+    if (bench_cfg.bin)
+        bench_bin_init(argc, argv);
+
+    if (bench_clock_init(bench_cfg.clock) != bench_cfg.clock)
+        bprintlf(YELLOW_FG "No invariant TSC with rdtscp, timing with CLOCK_MONOTONIC_RAW.");
+    bprintlf(GREEN_FG "Timer: %s, %.4f ns per tick, overhead %" PRIu64 " ticks (%.1f ns) taken out of every interval",
+             bench_clock_names[bench_clk.source], bench_clk.ns_per_tick, bench_clk.overhead, bench_clk.overhead * bench_clk.ns_per_tick);
+
+    if (workload)
+    {
+        char desc[256];
+        if (bench_wl_init() != 0)
+        {
+            dbprintlf(FATAL "Failed to allocate %d shared lines.", bench_wl.lines);
+            exit(4);
+        }
+        bench_wl_describe(desc, sizeof(desc));
+        bprintlf(GREEN_FG "Workload: %s (mean cs %.0f ns, mean think %.0f ns, %.2f loop iterations/ns)", desc, bench_wl.cs.mean, bench_wl.think.mean, bench_wl.iters_per_ns);
+    }
+
+    if (perf)
+    {
+        char why[256];
+        int n = bench_perf_probe(why, sizeof(why));
+        char paranoid[16] = "unknown";
+        FILE *fp = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+        if (fp != NULL)
+        {
+            if (fgets(paranoid, sizeof(paranoid), fp) != NULL)
+                paranoid[strcspn(paranoid, "\n")] = '\0';
+            fclose(fp);
+        }
+        if (n == 0)
+            bprintlf(YELLOW_FG "Performance counters are unavailable, continuing without them: %s. perf_event_paranoid is %s.", why, paranoid);
+        else if (n < BENCH_PERF_NEVENTS)
+            bprintlf(YELLOW_FG "Not counted: %s.", why);
+        if (n > 0 && bench_perf_cfg.exclude_kernel)
+            bprintlf(YELLOW_FG "perf_event_paranoid is %s, counting user space only.", paranoid);
+    }
+
+    bench_cfg.place = -1;
+    pthread_getaffinity_np(pthread_self(), sizeof(bench_cfg.affinity), &bench_cfg.affinity);
+    if (places != 0)
+    {
+        bench_cfg.nplaces = bench_topo_init(bench_cfg.places, places, &bench_cfg.affinity);
+        if (bench_cfg.nplaces == 0)
+            bprintlf(YELLOW_FG "No placement profile is available, threads are left unpinned.");
+        for (int p = 0; p < bench_cfg.nplaces; p++)
+        {
+            const struct bench_place *pl = &bench_cfg.places[p];
+            char cpus[BENCH_PLACE_CPUS * 6] = "";
+            size_t len = 0;
+            for (int c = 0; c < pl->ncpus && len < sizeof(cpus); c++)
+                len += snprintf(cpus + len, sizeof(cpus) - len, " %d", pl->cpus[c]);
+            bprintlf(GREEN_FG "Placement %s: CPUs%s", bench_place_names[pl->kind], cpus);
+            fprintf(bench_fopen(&bench_out.topo, "topo"), "%s,%s\n", bench_place_names[pl->kind], cpus);
+        }
+    }
+}
+
+/**
+ * @brief Closes result files and prints the total elapsed time.
+ */
+static inline int bench_finish(void)
+{
+    struct timespec stop, result;
+    FILE **fps[] = {&bench_out.rl, &bench_out.rl_sweep, &bench_out.sl_locks, &bench_out.sl_unlocks, &bench_out.ul, &bench_out.cl, &bench_out.rw, &bench_out.tl, &bench_out.tl_overshoot, &bench_out.pp, &bench_out.perf, &bench_out.fair, &bench_out.mutex, &bench_out.procs, &bench_out.depth, &bench_out.adapt, &bench_out.atomic, &bench_out.wake, &bench_out.layout, &bench_out.skew, &bench_out.lat, &bench_out.topo, &bench_out.bin};
+    for (unsigned i = 0; i < sizeof(fps) / sizeof(fps[0]); i++)
+    {
+        if (*fps[i] != NULL)
+        {
+            fclose(*fps[i]);
+            *fps[i] = NULL;
+        }
+    }
+
+    if (bench_sel.list)
+        return 0;
+    clock_gettime(CLOCK_REALTIME, &stop);
+    timespec_diff(&bench_cfg.start, &stop, &result);
+    bprintlf(BLUE_FG "[%s] Program Elapsed Time: %ld.%09ld ", bench_cfg.fname, result.tv_sec, result.tv_nsec);
+    return 0;
+}
+
+/**
+ * @brief Prints and records one remote-lock trial across n contenders, and
+ * adds its aggregate attempt rate to acc.
+ */
+static inline void bench_report_rl(const char *name, struct bench_thread *thr, int n, struct bench_rate *acc)
+{
+    // per-thread rate is attempts over that thread's own timed window
+    double total = 0, lo = 0, hi = 0;
+    for (int j = 0; j < n; j++)
+    {
+        double rate = thr[j].count / timespec_sec(&thr[j].diff);
+        total += rate;
+        if (j == 0 || rate < lo)
+            lo = rate;
+        if (j == 0 || rate > hi)
+            hi = rate;
+    }
+    acc->ops += total;
+    bench_bin_trial(name, "rl", thr, n);
+
+    if (bench_cfg.rl_quiet)
+    {
+        bprintlf(BLUE_FG "[%s] Threads: %d | Aggregate: %.0f attempts/s | Per-Thread: %.0f attempts/s (min %.0f, max %.0f)", name, n, total, total / n, lo, hi);
+        return;
+    }
+    if (n == 1 && bench_cfg.nthreads == 0 && bench_cfg.nplaces == 0)
+    {
+        bprintlf(BLUE_FG "[%s] Lock Attempts: %" PRIu64 " in %ld.%09ld s", name, thr[0].count, thr[0].diff.tv_sec, thr[0].diff.tv_nsec);
+        fprintf(bench_fopen(&bench_out.rl, "rl"), "%s, %ld.%09ld, %" PRIu64 ", %ld.%09ld\n", name, thr[0].start.tv_sec, thr[0].start.tv_nsec, thr[0].count, thr[0].diff.tv_sec, thr[0].diff.tv_nsec);
+        return;
+    }
+    bprintlf(BLUE_FG "[%s] Threads: %d | Aggregate: %.0f attempts/s | Per-Thread: %.0f attempts/s (min %.0f, max %.0f)", name, n, total, total / n, lo, hi);
+    fprintf(bench_fopen(&bench_out.rl_sweep, "rl_sweep"), "%s, %d, %.0f, %.0f, %.0f, %.0f\n", name, n, total, total / n, lo, hi);
+}
+
+/**
+ * @brief Prints and records one contended-lock trial across n threads, and
+ * adds its throughput and CPU burn to acc.
+ */
+static inline void bench_report_cl(const char *name, struct bench_thread *thr, int n, struct bench_rate *acc)
+{
+    double ops = 0, cpu = 0, wall = 0;
+    for (int j = 0; j < n; j++)
+    {
+        double sec = timespec_sec(&thr[j].diff);
+        ops += thr[j].count / sec;
+        cpu += timespec_sec(&thr[j].cpu);
+        if (sec > wall)
+            wall = sec;
+    }
+    cpu /= wall;
+    acc->ops += ops;
+    acc->cpu += cpu;
+    bench_bin_trial(name, "cl", thr, n);
+
+    bprintlf(BLUE_FG "[%s] Threads: %d | Acquisitions: %.0f /s | CPU: %.2f cores | %.0f acquisitions per CPU-second", name, n, ops, cpu, ops / cpu);
+    fprintf(bench_fopen(&bench_out.cl, "cl"), "%s, %d, %.0f, %.3f, %.0f\n", name, n, ops, cpu, ops / cpu);
+}
+
+/**
+ * @brief Prints and records the event counts of one trial of n workers per
+ * operation, an operation being one count of the case's loop. Events some
+ * worker could not count are left out (nan in the .data file).
+ */
+static inline void bench_report_perf(const char *name, const char *kase, struct bench_thread *thr, int n)
+{
+    if (bench_perf_cfg.avail == 0)
+        return;
+    uint64_t ops = 0;
+    uint32_t valid = bench_perf_cfg.avail;
+    double sum[BENCH_PERF_NEVENTS] = {0};
+    for (int j = 0; j < n; j++)
+    {
+        ops += thr[j].count;
+        valid &= thr[j].perf.valid;
+        for (int ev = 0; ev < BENCH_PERF_NEVENTS; ev++)
+            sum[ev] += thr[j].perf.count[ev];
+    }
+    if (ops == 0)
+        return;
+
+    char line[512];
+    size_t len = 0;
+    FILE *fp = bench_fopen(&bench_out.perf, "perf");
+    fprintf(fp, "%s, %s, %d, %" PRIu64, name, kase, n, ops);
+    for (int ev = 0; ev < BENCH_PERF_NEVENTS; ev++)
+    {
+        if (!(valid & (1u << ev)))
+        {
+            fprintf(fp, ", nan");
+            continue;
+        }
+        fprintf(fp, ", %.6g", sum[ev] / ops);
+        if (len < sizeof(line))
+            len += snprintf(line + len, sizeof(line) - len, "%s%s %.3g", len ? " | " : "", bench_perf_names[ev], sum[ev] / ops);
+    }
+    fprintf(fp, "\n");
+    bprintlf(CYAN_FG "[%s] %s x%d per op: %s", name, kase, n, valid ? line : "no counts");
+
+    if (!bench_cfg.bin)
+        return;
+    uint64_t *v = (uint64_t *)calloc((1 + BENCH_PERF_NEVENTS) * n, sizeof(uint64_t));
+    if (v == NULL)
+        return;
+    const void *cols[1 + BENCH_PERF_NEVENTS];
+    char kind[16];
+    snprintf(kind, sizeof(kind), "perf_%s", kase);
+    struct bench_bin_block b;
+    bench_bin_block_init(&b, name, kind, n, n);
+    bench_bin_block_col(&b, "count", BENCH_BIN_U64);
+    cols[0] = v;
+    for (int j = 0; j < n; j++)
+        v[j] = thr[j].count;
+    for (int ev = 0; ev < BENCH_PERF_NEVENTS; ev++)
+    {
+        if (!(valid & (1u << ev)))
+            continue;
+        uint64_t *col = v + b.ncols * n;
+        for (int j = 0; j < n; j++)
+            col[j] = thr[j].perf.count[ev];
+        cols[b.ncols] = col;
+        bench_bin_block_col(&b, bench_perf_names[ev], BENCH_BIN_U64);
+    }
+    bench_bin_emit(&b, cols);
+    free(v);
+}
+
+#ifndef BENCH_FAIR_MAX
+#define BENCH_FAIR_MAX 256 // cases and thread counts kept for bench_fair_summary()
+#endif
+
+/**
+ * @brief Fairness of one case at one thread count, over its trials.
+ */
+struct bench_fair
+{
+    char name[64];
+    int fifo;
+    int threads;
+    int trials;
+    double jain_sum;
+    double jain_min;
+    uint64_t max_wait; // ns
+    uint64_t max_gap;  // ns
+};
+
+static struct bench_fair bench_fair_runs[BENCH_FAIR_MAX];
+static int bench_fair_nruns;
+
+/**
+ * @brief Prints and records the fairness of one contended trial: Jain's
+ * index over the threads' acquisition rates (1 when all are equal, 1/n
+ * when one thread gets everything), each thread's share, the longest
+ * lock() call and the longest time any thread went without the lock.
+ */
+static inline void bench_report_fair(const char *name, int fifo, struct bench_thread *thr, int n)
+{
+    double sum = 0, sq = 0, lo = 0, hi = 0;
+    uint64_t wait = 0, gap = 0;
+    for (int j = 0; j < n; j++)
+    {
+        double rate = thr[j].count / timespec_sec(&thr[j].diff);
+        sum += rate;
+        sq += rate * rate;
+        if (j == 0 || rate < lo)
+            lo = rate;
+        if (j == 0 || rate > hi)
+            hi = rate;
+        if (thr[j].max_wait > wait)
+            wait = thr[j].max_wait;
+        if (thr[j].max_gap > gap)
+            gap = thr[j].max_gap;
+    }
+    double jain = sq > 0 ? sum * sum / (n * sq) : 1;
+    double min_share = sum > 0 ? lo / sum : 0, max_share = sum > 0 ? hi / sum : 0;
+
+    bprintlf(CYAN_FG "[%s] %s x%d | Jain %.4f | Share: min %.1f%%, max %.1f%% | Longest wait %" PRIu64 " ns | Longest starvation %" PRIu64 " ns",
+             name, fifo ? "FIFO" : "barging", n, jain, 100 * min_share, 100 * max_share, wait, gap);
+    fprintf(bench_fopen(&bench_out.fair, "fair"), "%s, %s, %d, %.4f, %.4f, %.4f, %" PRIu64 ", %" PRIu64 "\n",
+            name, fifo ? "fifo" : "barging", n, jain, min_share, max_share, wait, gap);
+
+    struct bench_fair *f = bench_fair_nruns > 0 ? &bench_fair_runs[bench_fair_nruns - 1] : NULL;
+    if (f == NULL || f->threads != n || strncmp(f->name, name, sizeof(f->name) - 1) != 0)
+    {
+        if (bench_fair_nruns == BENCH_FAIR_MAX)
+            return;
+        f = &bench_fair_runs[bench_fair_nruns++];
+        memset(f, 0, sizeof(*f));
+        snprintf(f->name, sizeof(f->name), "%s", name);
+        f->fifo = fifo;
+        f->threads = n;
+        f->jain_min = jain;
+    }
+    f->trials++;
+    f->jain_sum += jain;
+    if (jain < f->jain_min)
+        f->jain_min = jain;
+    if (wait > f->max_wait)
+        f->max_wait = wait;
+    if (gap > f->max_gap)
+        f->max_gap = gap;
+}
+
+/**
+ * @brief Prints every case recorded by bench_report_fair() so far, FIFO
+ * locks first, then barging ones, and forgets them.
+ */
+static inline void bench_fair_summary(void)
+{
+    if (bench_fair_nruns == 0)
+        return;
+    bprintlf(GREEN_FG "Fairness (Jain mean / worst, longest wait, longest starvation):");
+    for (int fifo = 1; fifo >= 0; fifo--)
+    {
+        for (int i = 0; i < bench_fair_nruns; i++)
+        {
+            const struct bench_fair *f = &bench_fair_runs[i];
+            if (f->fifo != fifo)
+                continue;
+            bprintlf(GREEN_FG "  %-8s %-40s x%-3d %.4f / %.4f  %12" PRIu64 " ns  %12" PRIu64 " ns", fifo ? "FIFO" : "barging",
+                     f->name, f->threads, f->jain_sum / f->trials, f->jain_min, f->max_wait, f->max_gap);
+        }
+    }
+    bench_fair_nruns = 0;
+}
+
+/**
+ * @brief Adds the start and stop skew of one trial of n workers to sk.
+ *
+ * Skew is the time between the first and the last worker to start (or
+ * stop) timing, from the timestamps each worker takes right after it sees
+ * the go (or done) signal.
+ */
+static inline void bench_skew_add(struct bench_skew *sk, struct bench_thread *thr, int n)
+{
+    // relative to a common second, absolute ns do not fit in a double
+    time_t base = thr[0].start.tv_sec;
+    int64_t first_start = 0, last_start = 0, first_stop = 0, last_stop = 0;
+    for (int j = 0; j < n; j++)
+    {
+        int64_t start = (int64_t)(thr[j].start.tv_sec - base) * 1000000000LL + thr[j].start.tv_nsec;
+        int64_t stop = start + (int64_t)thr[j].diff.tv_sec * 1000000000LL + thr[j].diff.tv_nsec;
+        if (j == 0 || start < first_start)
+            first_start = start;
+        if (j == 0 || start > last_start)
+            last_start = start;
+        if (j == 0 || stop < first_stop)
+            first_stop = stop;
+        if (j == 0 || stop > last_stop)
+            last_stop = stop;
+    }
+    double start_skew = (double)(last_start - first_start), stop_skew = (double)(last_stop - first_stop);
+    sk->trials++;
+    sk->start_sum += start_skew;
+    sk->stop_sum += stop_skew;
+    if (start_skew > sk->start_max)
+        sk->start_max = start_skew;
+    if (stop_skew > sk->stop_max)
+        sk->stop_max = stop_skew;
+}
+
+/**
+ * @brief Trial control for one case at one thread count. Without adaptive
+ * mode it runs the fixed number of trials. In adaptive mode it first runs
+ * a short calibration trial that is not reported, sizes the trials from
+ * it, then adds trials until the 95% confidence interval of the mean rate
+ * is narrower than bench_cfg.adapt_width of the mean, ADAPT_MAX_TRIALS
+ * have run, or bench_cfg.adapt_budget seconds have passed.
+ *
+ *   struct bench_adapt ad;
+ *   bench_adapt_begin(&ad, trials);
+ *   while (bench_adapt_more(&ad))
+ *   {
+ *       ...run a trial...
+ *       if (bench_adapt_calibrate(&ad, thr, n))
+ *           continue;
+ *       ...report the trial...
+ *       bench_adapt_add(&ad, thr, n);
+ *   }
+ *   bench_adapt_end(&ad, name, kase, n);  // ad.trials were reported
+ */
+struct bench_adapt
+{
+    int trials;      // reported so far
+    int max;
+    int calibrating; // the next trial is the calibration trial
+    double sum;      // of the trials' aggregate rates
+    double sq;
+    struct timespec start;
+};
+
+/**
+ * @brief Two-sided 95% Student t quantile with df degrees of freedom.
+ */
+static inline double bench_t95(int df)
+{
+    static const double t[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                               2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                               2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df < 1)
+        return 0;
+    return df <= (int)(sizeof(t) / sizeof(t[0])) ? t[df - 1] : 1.96;
+}
+
+/**
+ * @brief Half-width of the 95% confidence interval of the mean rate,
+ * relative to the mean; infinite with fewer than two trials.
+ */
+static inline double bench_adapt_ci(const struct bench_adapt *ad)
+{
+    if (ad->trials < 2 || ad->sum <= 0)
+        return INFINITY;
+    double mean = ad->sum / ad->trials;
+    double var = (ad->sq - ad->trials * mean * mean) / (ad->trials - 1);
+    return bench_t95(ad->trials - 1) * sqrt(var > 0 ? var : 0) / sqrt(ad->trials) / mean;
+}
+
+static inline void bench_adapt_begin(struct bench_adapt *ad, int trials)
+{
+    memset(ad, 0, sizeof(*ad));
+    ad->max = bench_cfg.adaptive ? ADAPT_MAX_TRIALS : trials;
+    ad->calibrating = bench_cfg.adaptive;
+    if (ad->calibrating)
+        bench_cfg.trial_ns = ADAPT_CAL_NS;
+    clock_gettime(CLOCK_MONOTONIC, &ad->start);
+}
+
+static inline int bench_adapt_more(const struct bench_adapt *ad)
+{
+    if (ad->calibrating)
+        return 1;
+    if (ad->trials >= ad->max)
+        return 0;
+    if (!bench_cfg.adaptive || ad->trials == 0)
+        return 1;
+    if (ad->trials >= ADAPT_MIN_TRIALS && 2 * bench_adapt_ci(ad) <= bench_cfg.adapt_width)
+        return 0;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return timespec_ns(&now) - timespec_ns(&ad->start) < bench_cfg.adapt_budget * 1e9;
+}
+
+/**
+ * @brief Aggregate rate of a trial: each worker's operations over its own
+ * timed window, summed.
+ */
+static inline double bench_trial_rate(const struct bench_thread *thr, int n)
+{
+    double rate = 0;
+    for (int j = 0; j < n; j++)
+    {
+        double sec = timespec_sec(&thr[j].diff);
+        if (sec > 0)
+            rate += thr[j].count / sec;
+    }
+    return rate;
+}
+
+/**
+ * @brief If the trial just run was the calibration trial, sizes the
+ * following trials from it and clears what it left in the histograms.
+ *
+ * A trial lasts long enough for ADAPT_MIN_OPS operations and for the
+ * workers' start and stop skew to be under 10% of it, but at least
+ * ADAPT_MIN_NS and at most bench_cfg.trig_timeout seconds.
+ *
+ * @return Whether the trial was the calibration trial, and so must not be
+ * reported.
+ */
+static inline int bench_adapt_calibrate(struct bench_adapt *ad, struct bench_thread *thr, int n)
+{
+    if (!ad->calibrating)
+        return 0;
+    ad->calibrating = 0;
+
+    struct bench_skew sk;
+    memset(&sk, 0, sizeof(sk));
+    bench_skew_add(&sk, thr, n);
+    double rate = bench_trial_rate(thr, n);
+    double ns = ADAPT_MIN_NS;
+    if (rate > 0 && ADAPT_MIN_OPS / rate * 1e9 > ns)
+        ns = ADAPT_MIN_OPS / rate * 1e9;
+    if (10 * sk.start_max > ns)
+        ns = 10 * sk.start_max;
+    if (10 * sk.stop_max > ns)
+        ns = 10 * sk.stop_max;
+    if (ns > bench_cfg.trig_timeout * 1e9)
+        ns = bench_cfg.trig_timeout * 1e9;
+    bench_cfg.trial_ns = (uint64_t)ns;
+
+    for (int j = 0; j < n && thr[0].hist != NULL; j++)
+        for (int op = 0; op < BENCH_NOPS; op++)
+            bench_hist_reset(&thr[j].hist[op]);
+    return 1;
+}
+
+static inline void bench_adapt_add(struct bench_adapt *ad, const struct bench_thread *thr, int n)
+{
+    double rate = bench_trial_rate(thr, n);
+    ad->trials++;
+    ad->sum += rate;
+    ad->sq += rate * rate;
+}
+
+/**
+ * @brief Prints and records, in adaptive mode, how many trials a case took
+ * and how far its mean converged, and puts the trial length back.
+ */
+static inline void bench_adapt_end(const struct bench_adapt *ad, const char *name, const char *kase, int n)
+{
+    if (!bench_cfg.adaptive)
+        return;
+    double ci = bench_adapt_ci(ad);
+    const char *why = 2 * ci <= bench_cfg.adapt_width ? "converged" : ad->trials >= ad->max ? "max" : "budget";
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double sec = (timespec_ns(&now) - timespec_ns(&ad->start)) * 1e-9;
+    bprintlf(GREEN_FG "[%s] %s x%d | %d trials of %.1f ms in %.2f s | Mean %.0f /s +/- %.2f%% (%s)",
+             name, kase, n, ad->trials, bench_cfg.trial_ns * 1e-6, sec, ad->trials ? ad->sum / ad->trials : 0, 100 * ci, why);
+    fprintf(bench_fopen(&bench_out.adapt, "adapt"), "%s, %s, %d, %d, %" PRIu64 ", %.3f, %.0f, %.4f, %s\n",
+            name, kase, n, ad->trials, bench_cfg.trial_ns, sec, ad->trials ? ad->sum / ad->trials : 0, ci, why);
+    bench_cfg.trial_ns = 0;
+}
+
+/**
+ * @brief Prints and records the start/stop skew of a multi-threaded run.
+ */
+static inline void bench_report_skew(const char *name, const char *kase, int n, const struct bench_skew *sk)
+{
+    if (n < 2 || sk->trials == 0)
+        return;
+    bprintlf(CYAN_FG "[%s] %s x%d | Start skew: mean %.0f ns, max %.0f ns | Stop skew: mean %.0f ns, max %.0f ns%s",
+             name, kase, n, sk->start_sum / sk->trials, sk->start_max, sk->stop_sum / sk->trials, sk->stop_max,
+             n > sysconf(_SC_NPROCESSORS_ONLN) ? " (more threads than CPUs, skew includes time slicing)" : "");
+    fprintf(bench_fopen(&bench_out.skew, "skew"), "%s, %s, %d, %.0f, %.0f, %.0f, %.0f\n",
+            name, kase, n, sk->start_sum / sk->trials, sk->start_max, sk->stop_sum / sk->trials, sk->stop_max);
+}
+
+/**
+ * @brief Recursion depths of the sweep in bench_depth_<lock>().
+ */
+static const int bench_depths[] = {1, 2, 4, 8, 16, 64, 256, 1024};
+
+/**
+ * @brief Prints and records the re-lock and unlock cost of a recursive lock
+ * at one recursion depth.
+ */
+static inline void bench_report_depth(const char *name, int depth, double lock_ns, double unlock_ns)
+{
+    bprintlf(BLUE_FG "[%s] Depth %4d | Re-lock: %.2f ns | Unlock: %.2f ns", name, depth, lock_ns, unlock_ns);
+    fprintf(bench_fopen(&bench_out.depth, "depth"), "%s, %d, %.3f, %.3f\n", name, depth, lock_ns, unlock_ns);
+}
+
+/**
+ * @brief Prints and records the packed vs. isolated throughput of a case.
+ */
+static inline void bench_report_layout(const char *name, const char *kase, int n, double packed, double isolated)
+{
+    double gain = packed > 0 ? (isolated / packed - 1) * 100 : 0;
+    bprintlf(GREEN_FG "[%s] %s x%d | Packed: %.0f /s | Isolated: %.0f /s | Isolated is %+.1f%%", name, kase, n, packed, isolated, gain);
+    fprintf(bench_fopen(&bench_out.layout, "layout"), "%s, %s, %d, %.0f, %.0f, %.2f\n", name, kase, n, packed, isolated, gain);
+}
+
+/**
+ * @brief Allocates BENCH_NOPS histograms for each of n threads.
+ */
+static inline void bench_hist_attach(struct bench_thread *thr, int n)
+{
+    struct bench_hist *h = bench_hist_alloc(n * BENCH_NOPS);
+    if (h == NULL)
+    {
+        dbprintlf(FATAL "Failed to allocate histograms for %d threads.", n);
+        exit(4);
+    }
+    for (int j = 0; j < n; j++)
+        thr[j].hist = &h[j * BENCH_NOPS];
+}
+
+static inline void bench_hist_detach(struct bench_thread *thr)
+{
+    free(thr[0].hist);
+    thr[0].hist = NULL;
+}
+
+/**
+ * @brief Merges the per-thread histograms of n threads, reports the tail
+ * latency of every operation that was recorded, and resets them.
+ *
+ * Latencies are in ns, with the timer overhead taken out.
+ */
+static inline void bench_report_lat(const char *name, struct bench_thread *thr, int n)
+{
+    struct bench_hist *total = bench_hist_alloc(1);
+    if (total == NULL)
+        return;
+    for (int op = 0; op < BENCH_NOPS; op++)
+    {
+        bench_hist_reset(total);
+        for (int j = 0; j < n; j++)
+        {
+            bench_hist_merge(total, &thr[j].hist[op]);
+            bench_hist_reset(&thr[j].hist[op]);
+        }
+        if (total->count == 0)
+            continue;
+
+        uint64_t p50 = bench_hist_quantile(total, 0.50);
+        uint64_t p99 = bench_hist_quantile(total, 0.99);
+        uint64_t p999 = bench_hist_quantile(total, 0.999);
+        bprintlf(MAGENTA_FG "[%s] %s x%d | Samples: %" PRIu64 " | p50 %" PRIu64 " | p99 %" PRIu64 " | p99.9 %" PRIu64 " | max %" PRIu64 " ns",
+                 name, bench_op_names[op], n, total->count, p50, p99, p999, total->max);
+        bench_bin_hist(name, op, n, total);
+        fprintf(bench_fopen(&bench_out.lat, "lat"), "%s, %s, %d, %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 "\n",
+                name, bench_op_names[op], n, total->count, total->min, p50, p99, p999, total->max);
+    }
+    free(total);
+}
+
+/**
+ * @brief Runs trials of a contended case at n threads in the given layout
+ * and returns its mean rate; generated per lock by the case templates.
+ */
+typedef struct bench_rate (*bench_run_fn)(const char *name, struct bench_thread *thr, pthread_t *threads, int n, int trials, int layout);
+
+/**
+ * @brief Runs a contended case at n threads in the configured layout, or in
+ * both layouts when studying false sharing.
+ */
+static inline struct bench_rate bench_point(bench_run_fn run, const char *kase, const char *name, struct bench_thread *thr, pthread_t *threads, int n, int trials)
+{
+    if (!bench_cfg.layout_study)
+        return run(name, thr, threads, n, trials, bench_cfg.layout);
+
+    struct bench_rate packed = run(name, thr, threads, n, trials, BENCH_LAYOUT_PACKED);
+    struct bench_rate isolated = run(name, thr, threads, n, trials, BENCH_LAYOUT_ISOLATED);
+    bench_report_layout(name, kase, n, packed.ops, isolated.ops);
+    return isolated;
+}
+
+/**
+ * @brief Prints and records the throughput of a case with threads against
+ * the same case with processes sharing the lock through shared memory.
+ */
+static inline void bench_report_procs(const char *name, const char *kase, int n, double threads, double procs)
+{
+    double overhead = procs > 0 ? (threads / procs - 1) * 100 : 0;
+    bprintlf(GREEN_FG "[%s] %s x%d | Threads: %.0f /s | Processes: %.0f /s | Process overhead %+.1f%%", name, kase, n, threads, procs, overhead);
+    fprintf(bench_fopen(&bench_out.procs, "procs"), "%s, %s, %d, %.0f, %.0f, %.2f\n", name, kase, n, threads, procs, overhead);
+}
+
+/**
+ * @brief Runs trials of a case at n workers as threads, then as forked
+ * processes, and reports the difference. Runs are named "<name> threads"
+ * and "<name> procs".
+ *
+ * @return The rate with processes.
+ */
+static inline struct bench_rate bench_procs_point(bench_run_fn run, const char *kase, const char *name, struct bench_thread *thr, pthread_t *threads, int n, int trials, int layout)
+{
+    char label[160];
+    snprintf(label, sizeof(label), "%s threads", name);
+    struct bench_rate in = run(label, thr, threads, n, trials, layout);
+    snprintf(label, sizeof(label), "%s procs", name);
+    bench_cfg.trial_procs = 1;
+    struct bench_rate out = run(label, thr, threads, n, trials, layout);
+    bench_cfg.trial_procs = 0;
+    bench_report_procs(name, kase, n, in.ops, out.ops);
+    return out;
+}
+
+/**
+ * @brief Runs a contended case at n_default threads, or at each count in
+ * bench_cfg.threads, once unpinned or once per placement profile. Sweep
+ * mode runs bench_cfg.sweep_trials trials at each count instead of trials.
+ * Pinned runs are named "<name> @<profile>".
+ *
+ * @return Mean throughput and CPU burn of the last thread count run.
+ */
+static inline struct bench_rate bench_contended(bench_run_fn run, const char *kase, const char *name, int n_default, int trials)
+{
+    int max_threads = bench_cfg.max_threads > n_default ? bench_cfg.max_threads : n_default;
+    struct bench_rate rate = {0, 0};
+    pthread_t *threads = (pthread_t *)calloc(max_threads, sizeof(pthread_t));
+    struct bench_thread *thr = (struct bench_thread *)calloc(max_threads, sizeof(struct bench_thread));
+    if (threads == NULL || thr == NULL)
+    {
+        dbprintlf(FATAL "Failed to allocate %d threads.", max_threads);
+        exit(4);
+    }
+    if (bench_cfg.latency)
+        bench_hist_attach(thr, max_threads);
+
+    int nplaces = bench_cfg.nplaces > 0 ? bench_cfg.nplaces : 1;
+    for (int p = 0; p < nplaces; p++)
+    {
+        char label[128];
+        bench_cfg.place = bench_cfg.nplaces > 0 ? p : -1;
+        if (bench_cfg.place < 0)
+            snprintf(label, sizeof(label), "%s", name);
+        else
+            snprintf(label, sizeof(label), "%s @%s", name, bench_place_names[bench_cfg.places[p].kind]);
+
+        if (bench_cfg.nthreads > 0)
+        {
+            for (int k = 0; k < bench_cfg.nthreads; k++)
+                rate = bench_point(run, kase, label, thr, threads, bench_cfg.threads[k], bench_cfg.sweep ? bench_cfg.sweep_trials : trials);
+        }
+        else
+        {
+            rate = bench_point(run, kase, label, thr, threads, n_default, trials);
+        }
+    }
+    bench_cfg.place = -1;
+
+    if (bench_cfg.latency)
+        bench_hist_detach(thr);
+    free(thr);
+    free(threads);
+    return rate;
+}
+
+#endif // BENCH_H
@@ -0,0 +1,336 @@
+/**
+ * @file bench_atomic.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Atomic-primitive baselines: the operations locks are built from.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * Each primitive is a strong compare-exchange, exchange, fetch-add, load
+ * or store at one memory order, and is instantiated through bench_case.h
+ * as if it were a lock: its trylock is the operation itself, on a word the
+ * main thread has set to 1 ("locked"). The remote-lock case then runs it
+ * in the same loop as every lock's trylock. "cas" expects the 1 it finds
+ * and succeeds, writing the 1 back; "cas_fail" expects 0 and fails exactly
+ * as a trylock on a held lock does.
+ *
+ * The memory order is a compile-time constant in every instantiation, as
+ * the compiler needs it to be to pick the instructions. In C the operations
+ * are the __atomic builtins; define BENCH_ATOMIC_STD before including this
+ * header to use std::atomic<uint64_t> and std::memory_order instead.
+ * memory_order_consume is left out: compilers treat it as acquire.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_ATOMIC_H
+#define BENCH_ATOMIC_H
+
+#include "bench.h"
+
+#ifdef BENCH_ATOMIC_STD
+
+#include <atomic>
+
+typedef std::atomic<uint64_t> bench_atomic_t;
+#define BENCH_MO(o) std::memory_order_##o
+#define BENCH_AT_SET(p, v) (p)->store(v)
+#define BENCH_AT_CAS(p, o, f, e) ({ uint64_t _e = (e); (p)->compare_exchange_strong(_e, 1, BENCH_MO(o), BENCH_MO(f)); })
+#define BENCH_AT_XCHG(p, o) (p)->exchange(1, BENCH_MO(o))
+#define BENCH_AT_FADD(p, o) (p)->fetch_add(1, BENCH_MO(o))
+#define BENCH_AT_LOAD(p, o) (p)->load(BENCH_MO(o))
+#define BENCH_AT_STORE(p, o) ((p)->store(1, BENCH_MO(o)), 1)
+
+#else
+
+typedef uint64_t bench_atomic_t;
+#define BENCH_MO_relaxed __ATOMIC_RELAXED
+#define BENCH_MO_acquire __ATOMIC_ACQUIRE
+#define BENCH_MO_release __ATOMIC_RELEASE
+#define BENCH_MO_acq_rel __ATOMIC_ACQ_REL
+#define BENCH_MO_seq_cst __ATOMIC_SEQ_CST
+#define BENCH_MO(o) BENCH_MO_##o
+#define BENCH_AT_SET(p, v) __atomic_store_n(p, v, __ATOMIC_SEQ_CST)
+#define BENCH_AT_CAS(p, o, f, e) ({ uint64_t _e = (e); __atomic_compare_exchange_n(p, &_e, 1, 0, BENCH_MO(o), BENCH_MO(f)); })
+#define BENCH_AT_XCHG(p, o) __atomic_exchange_n(p, 1, BENCH_MO(o))
+#define BENCH_AT_FADD(p, o) __atomic_fetch_add(p, 1, BENCH_MO(o))
+#define BENCH_AT_LOAD(p, o) __atomic_load_n(p, BENCH_MO(o))
+#define BENCH_AT_STORE(p, o) (__atomic_store_n(p, 1, BENCH_MO(o)), 1)
+
+#endif // BENCH_ATOMIC_STD
+
+/**
+ * @brief Defines the lock operations of primitive at_<op>_<o>: lock and
+ * unlock set the word to 1 and 0, trylock runs expr on it.
+ */
+#define BENCH_ATOMIC_PRIM(op, o, expr)                                                 \
+    static inline void at_##op##_##o##_init(bench_atomic_t *p) { BENCH_AT_SET(p, 0); } \
+    static inline void at_##op##_##o##_destroy(bench_atomic_t *p) { (void)p; }         \
+    static inline void at_##op##_##o##_lock(bench_atomic_t *p) { BENCH_AT_SET(p, 1); } \
+    static inline int at_##op##_##o##_trylock(bench_atomic_t *p) { return (int)(expr); } \
+    static inline void at_##op##_##o##_unlock(bench_atomic_t *p) { BENCH_AT_SET(p, 0); }
+
+// a failed compare-exchange only loads, so its order drops any release part
+BENCH_ATOMIC_PRIM(cas, relaxed, BENCH_AT_CAS(p, relaxed, relaxed, 1))
+BENCH_ATOMIC_PRIM(cas, acquire, BENCH_AT_CAS(p, acquire, acquire, 1))
+BENCH_ATOMIC_PRIM(cas, release, BENCH_AT_CAS(p, release, relaxed, 1))
+BENCH_ATOMIC_PRIM(cas, acq_rel, BENCH_AT_CAS(p, acq_rel, acquire, 1))
+BENCH_ATOMIC_PRIM(cas, seq_cst, BENCH_AT_CAS(p, seq_cst, seq_cst, 1))
+BENCH_ATOMIC_PRIM(casf, relaxed, BENCH_AT_CAS(p, relaxed, relaxed, 0))
+BENCH_ATOMIC_PRIM(casf, acquire, BENCH_AT_CAS(p, acquire, acquire, 0))
+BENCH_ATOMIC_PRIM(casf, release, BENCH_AT_CAS(p, release, relaxed, 0))
+BENCH_ATOMIC_PRIM(casf, acq_rel, BENCH_AT_CAS(p, acq_rel, acquire, 0))
+BENCH_ATOMIC_PRIM(casf, seq_cst, BENCH_AT_CAS(p, seq_cst, seq_cst, 0))
+BENCH_ATOMIC_PRIM(xchg, relaxed, BENCH_AT_XCHG(p, relaxed))
+BENCH_ATOMIC_PRIM(xchg, acquire, BENCH_AT_XCHG(p, acquire))
+BENCH_ATOMIC_PRIM(xchg, release, BENCH_AT_XCHG(p, release))
+BENCH_ATOMIC_PRIM(xchg, acq_rel, BENCH_AT_XCHG(p, acq_rel))
+BENCH_ATOMIC_PRIM(xchg, seq_cst, BENCH_AT_XCHG(p, seq_cst))
+BENCH_ATOMIC_PRIM(fadd, relaxed, BENCH_AT_FADD(p, relaxed))
+BENCH_ATOMIC_PRIM(fadd, acquire, BENCH_AT_FADD(p, acquire))
+BENCH_ATOMIC_PRIM(fadd, release, BENCH_AT_FADD(p, release))
+BENCH_ATOMIC_PRIM(fadd, acq_rel, BENCH_AT_FADD(p, acq_rel))
+BENCH_ATOMIC_PRIM(fadd, seq_cst, BENCH_AT_FADD(p, seq_cst))
+BENCH_ATOMIC_PRIM(load, relaxed, BENCH_AT_LOAD(p, relaxed))
+BENCH_ATOMIC_PRIM(load, acquire, BENCH_AT_LOAD(p, acquire))
+BENCH_ATOMIC_PRIM(load, seq_cst, BENCH_AT_LOAD(p, seq_cst))
+BENCH_ATOMIC_PRIM(store, relaxed, BENCH_AT_STORE(p, relaxed))
+BENCH_ATOMIC_PRIM(store, release, BENCH_AT_STORE(p, release))
+BENCH_ATOMIC_PRIM(store, seq_cst, BENCH_AT_STORE(p, seq_cst))
+
+#define BENCH_LOCK at_cas_relaxed
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_cas_acquire
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_cas_release
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_cas_acq_rel
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_cas_seq_cst
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_casf_relaxed
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_casf_acquire
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_casf_release
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_casf_acq_rel
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_casf_seq_cst
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_xchg_relaxed
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_xchg_acquire
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_xchg_release
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_xchg_acq_rel
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_xchg_seq_cst
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_fadd_relaxed
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_fadd_acquire
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_fadd_release
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_fadd_acq_rel
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_fadd_seq_cst
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_load_relaxed
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_load_acquire
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_load_seq_cst
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_store_relaxed
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_store_release
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+#define BENCH_LOCK at_store_seq_cst
+#define BENCH_LOCK_T bench_atomic_t
+#include "bench_case.h"
+
+struct bench_atomic_prim
+{
+    const char *name; // "<op> <order>", as selected and reported
+    bench_run_fn run;
+};
+
+static const struct bench_atomic_prim bench_atomic_prims[] = {
+    {"cas relaxed", &bench_rl_n_at_cas_relaxed},
+    {"cas acquire", &bench_rl_n_at_cas_acquire},
+    {"cas release", &bench_rl_n_at_cas_release},
+    {"cas acq_rel", &bench_rl_n_at_cas_acq_rel},
+    {"cas seq_cst", &bench_rl_n_at_cas_seq_cst},
+    {"cas_fail relaxed", &bench_rl_n_at_casf_relaxed},
+    {"cas_fail acquire", &bench_rl_n_at_casf_acquire},
+    {"cas_fail release", &bench_rl_n_at_casf_release},
+    {"cas_fail acq_rel", &bench_rl_n_at_casf_acq_rel},
+    {"cas_fail seq_cst", &bench_rl_n_at_casf_seq_cst},
+    {"exchange relaxed", &bench_rl_n_at_xchg_relaxed},
+    {"exchange acquire", &bench_rl_n_at_xchg_acquire},
+    {"exchange release", &bench_rl_n_at_xchg_release},
+    {"exchange acq_rel", &bench_rl_n_at_xchg_acq_rel},
+    {"exchange seq_cst", &bench_rl_n_at_xchg_seq_cst},
+    {"fetch_add relaxed", &bench_rl_n_at_fadd_relaxed},
+    {"fetch_add acquire", &bench_rl_n_at_fadd_acquire},
+    {"fetch_add release", &bench_rl_n_at_fadd_release},
+    {"fetch_add acq_rel", &bench_rl_n_at_fadd_acq_rel},
+    {"fetch_add seq_cst", &bench_rl_n_at_fadd_seq_cst},
+    {"load relaxed", &bench_rl_n_at_load_relaxed},
+    {"load acquire", &bench_rl_n_at_load_acquire},
+    {"load seq_cst", &bench_rl_n_at_load_seq_cst},
+    {"store relaxed", &bench_rl_n_at_store_relaxed},
+    {"store release", &bench_rl_n_at_store_release},
+    {"store seq_cst", &bench_rl_n_at_store_seq_cst},
+};
+
+#define BENCH_ATOMIC_NPRIMS (sizeof(bench_atomic_prims) / sizeof(bench_atomic_prims[0]))
+
+/**
+ * @brief Runs every selected primitive (kind "atomic") through the
+ * remote-lock case, uncontended and then with bench_cfg.cl_threads
+ * contenders on its one cache line, or at each count in bench_cfg.threads.
+ * Then prints and writes to the atomic results file, for every count, the
+ * cost of one operation, that cost as a multiple of the uncontended cost,
+ * and the cost of ref's trylock as a multiple of it.
+ *
+ * @param ref Name of the lock to compare with.
+ * @param ref_ops Attempts/s of ref's remote-lock case, at the last thread
+ * count in bench_cfg.threads or else uncontended; 0 to leave the
+ * comparison out.
+ */
+static inline void bench_atomic_baseline(const char *ref, double ref_ops)
+{
+    int counts[BENCH_COUNTS_MAX + 1], ncounts = 0;
+    counts[ncounts++] = 1;
+    if (bench_cfg.nthreads > 0)
+    {
+        for (int k = 0; k < bench_cfg.nthreads; k++)
+            if (bench_cfg.threads[k] > 1)
+                counts[ncounts++] = bench_cfg.threads[k];
+    }
+    else if (bench_cfg.cl_threads > 1)
+    {
+        counts[ncounts++] = bench_cfg.cl_threads;
+    }
+    const int ref_n = bench_cfg.nthreads > 0 ? bench_cfg.threads[bench_cfg.nthreads - 1] : 1;
+    const int trials = bench_cfg.nthreads > 0 && bench_cfg.sweep ? bench_cfg.sweep_trials : bench_cfg.cl_trials;
+
+    double (*ops)[BENCH_COUNTS_MAX + 1] = (double (*)[BENCH_COUNTS_MAX + 1])calloc(BENCH_ATOMIC_NPRIMS, sizeof(*ops));
+    if (ops == NULL)
+    {
+        dbprintlf(FATAL "Failed to allocate the atomic baselines.");
+        exit(4);
+    }
+    int ran[BENCH_ATOMIC_NPRIMS], nran = 0;
+    const int nthreads = bench_cfg.nthreads;
+    bench_cfg.nthreads = 0; // one count per call, so every count is kept
+    bench_cfg.rl_quiet = 1; // the table below is their only result file
+    for (size_t i = 0; i < BENCH_ATOMIC_NPRIMS; i++)
+    {
+        const struct bench_atomic_prim *p = &bench_atomic_prims[i];
+        if (!(ran[i] = bench_selected("atomic", p->name)))
+            continue;
+        nran++;
+        for (int k = 0; k < ncounts; k++)
+            ops[i][k] = bench_contended(p->run, "rl", p->name, counts[k], trials).ops;
+    }
+    bench_cfg.rl_quiet = 0;
+    bench_cfg.nthreads = nthreads;
+    if (nran == 0)
+    {
+        free(ops);
+        return;
+    }
+
+    bprintlf(GREEN_FG "Atomic baselines (attempts/s, ns per attempt per thread, multiple of x1, %s trylock in attempts):", ref);
+    FILE *fp = bench_fopen(&bench_out.atomic, "atomic");
+    for (size_t i = 0; i < BENCH_ATOMIC_NPRIMS; i++)
+    {
+        if (!ran[i] || ops[i][0] <= 0)
+            continue;
+        const char *name = bench_atomic_prims[i].name;
+        const double ns_one = 1e9 / ops[i][0];
+        for (int k = 0; k < ncounts; k++)
+        {
+            if (ops[i][k] <= 0)
+                continue;
+            double ns = 1e9 * counts[k] / ops[i][k];
+            double multiple = ref_ops > 0 && counts[k] == ref_n ? ops[i][k] / ref_ops : 0;
+            char cmp[96] = "";
+            if (multiple > 0)
+                snprintf(cmp, sizeof(cmp), "  %s = %.2f", ref, multiple);
+            bprintlf(GREEN_FG "  %-18s x%-3d %12.0f /s %8.2f ns %6.2fx%s", name, counts[k], ops[i][k], ns, ns / ns_one, cmp);
+            fprintf(fp, "%s, %s, %d, %.0f, %.3f, %.3f, %.3f\n", name, ref, counts[k], ops[i][k], ns, ns / ns_one, multiple);
+        }
+    }
+    free(ops);
+}
+
+#endif // BENCH_ATOMIC_H
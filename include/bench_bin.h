@@ -0,0 +1,264 @@
+/**
+ * @file bench_bin.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Self-describing binary result file: layout, writer and mmap reader.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * A file is one struct bench_bin_header describing the run (host, kernel,
+ * compiler, program, arguments and build-time settings), followed by
+ * blocks. Each block is a struct bench_bin_block naming the case, the kind
+ * of measurement and the thread count, followed by its columns stored one
+ * after the other. Every column value is 8 bytes wide and every block
+ * starts 8-byte aligned, so a reader can mmap the file and use the columns
+ * in place. Blocks carry their own size, so readers skip what they do not
+ * know.
+ *
+ * Values are written in host byte order; header.endian tells readers which
+ * that was.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_BIN_H
+#define BENCH_BIN_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BENCH_BIN_MAGIC "MTTBENCH"
+#define BENCH_BIN_VERSION 2
+#define BENCH_BIN_BLOCK_MAGIC 0x314b4c42u // "BLK1"
+#define BENCH_BIN_ENDIAN 0x01020304u
+#define BENCH_BIN_COLS 8
+
+enum bench_bin_type
+{
+    BENCH_BIN_U64,
+    BENCH_BIN_I64,
+    BENCH_BIN_F64,
+};
+
+/**
+ * @brief File header, written once at the start of the file.
+ */
+struct bench_bin_header
+{
+    char magic[8];              // BENCH_BIN_MAGIC, not NUL-terminated
+    uint32_t version;           // BENCH_BIN_VERSION
+    uint32_t endian;            // BENCH_BIN_ENDIAN as written by the host
+    uint32_t header_size;       // sizeof(struct bench_bin_header), first block starts here
+    uint32_t block_header_size; // sizeof(struct bench_bin_block)
+    uint64_t start_ns;          // CLOCK_REALTIME at program start
+    int32_t ncpus;              // online CPUs
+    int32_t trial_ms;           // duration, ms per timed trial
+    int32_t trials;             // trials
+    int32_t sweep_trials;       // trials per thread count in sweep mode
+    int32_t cl_threads;         // threads of the contended cases by default
+    int32_t cl_trials;          // trials of the contended cases
+    char host[72];
+    char kernel[256]; // uname sysname, release and version
+    char machine[72];
+    char compiler[128];
+    char program[64];
+    char args[256];
+};
+
+/**
+ * @brief Describes one column of a block.
+ */
+struct bench_bin_col
+{
+    char name[24];
+    uint32_t type; // enum bench_bin_type
+    uint32_t reserved;
+    uint64_t offset; // from the start of the block
+};
+
+/**
+ * @brief Block header, followed by ncols columns of nrows 8-byte values.
+ */
+struct bench_bin_block
+{
+    uint32_t magic; // BENCH_BIN_BLOCK_MAGIC
+    uint32_t ncols;
+    uint64_t nrows;
+    uint64_t size; // of the whole block; the next block starts this far on
+    char name[64]; // case, e.g. "TAS @smt"
+    char kind[16]; // rl, cl, rw, ul, sl_locks, sl_unlocks, lat_<op>
+    int32_t threads;
+    int32_t layout; // enum bench_layout_kind
+    int32_t place;  // enum bench_place_kind, -1 if unpinned
+    int32_t reserved;
+    struct bench_bin_col cols[BENCH_BIN_COLS];
+};
+
+/**
+ * @brief Starts a block of nrows rows. Add columns with bench_bin_block_col().
+ */
+static inline void bench_bin_block_init(struct bench_bin_block *b, const char *name, const char *kind, int threads, uint64_t nrows)
+{
+    memset(b, 0, sizeof(*b));
+    b->magic = BENCH_BIN_BLOCK_MAGIC;
+    b->nrows = nrows;
+    b->threads = threads;
+    b->place = -1;
+    snprintf(b->name, sizeof(b->name), "%s", name);
+    snprintf(b->kind, sizeof(b->kind), "%s", kind);
+}
+
+/**
+ * @brief Adds a column and places it after the previous ones.
+ *
+ * @return The column's index, or -1 if the block is full.
+ */
+static inline int bench_bin_block_col(struct bench_bin_block *b, const char *name, int type)
+{
+    if (b->ncols >= BENCH_BIN_COLS)
+        return -1;
+    struct bench_bin_col *c = &b->cols[b->ncols];
+    strncpy(c->name, name, sizeof(c->name) - 1);
+    c->type = type;
+    c->offset = sizeof(*b) + b->ncols * b->nrows * sizeof(uint64_t);
+    b->size = c->offset + b->nrows * sizeof(uint64_t);
+    return (int)b->ncols++;
+}
+
+/**
+ * @brief Writes a block; cols[i] points at nrows 8-byte values of column i.
+ *
+ * @return 0 on success, -1 on a short write.
+ */
+static inline int bench_bin_block_write(FILE *fp, const struct bench_bin_block *b, const void *const *cols)
+{
+    if (fwrite(b, sizeof(*b), 1, fp) != 1)
+        return -1;
+    for (uint32_t i = 0; i < b->ncols; i++)
+    {
+        if (b->nrows > 0 && fwrite(cols[i], sizeof(uint64_t), b->nrows, fp) != b->nrows)
+            return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief A result file mapped into memory for reading.
+ */
+struct bench_bin_map
+{
+    const char *mem;
+    size_t size;
+    const struct bench_bin_header *hdr;
+};
+
+/**
+ * @brief Maps the file at path and checks its header.
+ *
+ * @return 0 on success, -1 if the file cannot be mapped or is not a result
+ * file of this version written on a host of the same byte order.
+ */
+static inline int bench_bin_open(struct bench_bin_map *m, const char *path)
+{
+    memset(m, 0, sizeof(*m));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct bench_bin_header))
+    {
+        close(fd);
+        return -1;
+    }
+    void *mem = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+        return -1;
+
+    m->mem = (const char *)mem;
+    m->size = st.st_size;
+    m->hdr = (const struct bench_bin_header *)mem;
+    if (memcmp(m->hdr->magic, BENCH_BIN_MAGIC, sizeof(m->hdr->magic)) != 0 || m->hdr->version != BENCH_BIN_VERSION ||
+        m->hdr->endian != BENCH_BIN_ENDIAN || m->hdr->header_size > m->size || m->hdr->block_header_size != sizeof(struct bench_bin_block))
+    {
+        munmap(mem, m->size);
+        memset(m, 0, sizeof(*m));
+        return -1;
+    }
+    return 0;
+}
+
+static inline void bench_bin_close(struct bench_bin_map *m)
+{
+    if (m->mem != NULL)
+        munmap((void *)m->mem, m->size);
+    memset(m, 0, sizeof(*m));
+}
+
+/**
+ * @brief Returns the block after prev (the first block if prev is NULL), or
+ * NULL at the end of the file or at a truncated block.
+ */
+static inline const struct bench_bin_block *bench_bin_next(const struct bench_bin_map *m, const struct bench_bin_block *prev)
+{
+    size_t off = prev == NULL ? m->hdr->header_size : (size_t)((const char *)prev - m->mem) + prev->size;
+    if (off + sizeof(struct bench_bin_block) > m->size)
+        return NULL;
+    const struct bench_bin_block *b = (const struct bench_bin_block *)(m->mem + off);
+    if (b->magic != BENCH_BIN_BLOCK_MAGIC || b->size < sizeof(*b) || b->size > m->size - off || b->ncols > BENCH_BIN_COLS)
+        return NULL;
+    for (uint32_t i = 0; i < b->ncols; i++)
+    {
+        if (b->cols[i].offset % sizeof(uint64_t) != 0 || b->cols[i].offset > b->size || b->nrows > (b->size - b->cols[i].offset) / sizeof(uint64_t))
+            return NULL;
+    }
+    return b;
+}
+
+/**
+ * @brief Returns the index of the column called name, or -1.
+ */
+static inline int bench_bin_find(const struct bench_bin_block *b, const char *name)
+{
+    for (uint32_t i = 0; i < b->ncols; i++)
+    {
+        if (strncmp(b->cols[i].name, name, sizeof(b->cols[i].name)) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+static inline const uint64_t *bench_bin_u64(const struct bench_bin_block *b, int col)
+{
+    return (const uint64_t *)((const char *)b + b->cols[col].offset);
+}
+
+static inline const int64_t *bench_bin_i64(const struct bench_bin_block *b, int col)
+{
+    return (const int64_t *)((const char *)b + b->cols[col].offset);
+}
+
+static inline const double *bench_bin_f64(const struct bench_bin_block *b, int col)
+{
+    return (const double *)((const char *)b + b->cols[col].offset);
+}
+
+#endif // BENCH_BIN_H
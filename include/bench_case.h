@@ -0,0 +1,835 @@
+/**
+ * @file bench_case.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Measurement loops, specialized per lock type at compile time.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * This header has no include guard on purpose: include it once per lock
+ * type after defining
+ *
+ *   BENCH_LOCK            name of the lock, e.g. mtx_default
+ *   BENCH_LOCK_T          the lock's storage type, e.g. pthread_mutex_t
+ *   BENCH_LOCK_RECURSIVE  (optional) lock may be re-locked by its owner
+ *   BENCH_LOCK_TIMED      (optional) lock has a timed lock, see below
+ *   BENCH_LOCK_FIFO       (optional) lock grants waiters in arrival order
+ *   BENCH_LOCK_PSHARED    (optional) lock works between processes that map it
+ *
+ * The lock must provide, in the style of the pthread API,
+ *
+ *   void BENCH_LOCK_init(BENCH_LOCK_T *);
+ *   void BENCH_LOCK_destroy(BENCH_LOCK_T *);
+ *   void BENCH_LOCK_lock(BENCH_LOCK_T *);
+ *   int  BENCH_LOCK_trylock(BENCH_LOCK_T *);  // 0 on success
+ *   void BENCH_LOCK_unlock(BENCH_LOCK_T *);
+ *
+ * and, with BENCH_LOCK_TIMED, a lock with an absolute deadline on either
+ * CLOCK_REALTIME or CLOCK_MONOTONIC,
+ *
+ *   int  BENCH_LOCK_timedlock(BENCH_LOCK_T *, clockid_t, const struct timespec *);  // 0 or ETIMEDOUT
+ *
+ * and gets, for example with BENCH_LOCK = mtx_default,
+ *
+ *   struct bench_rate bench_rl_mtx_default(const char *name);  // CASE ONE / TWO
+ *   void bench_sl_mtx_default(const char *name);  // CASE THREE, recursive only
+ *   void bench_depth_mtx_default(const char *name);  // CASE THREE, recursive only
+ *   double bench_ul_mtx_default(const char *name);  // CASE FOUR
+ *   struct bench_rate bench_cl_mtx_default(const char *name);  // CASE FIVE
+ *   void bench_pp_mtx_default(const char *name);  // CASE EIGHT
+ *   void bench_tl_mtx_default(const char *name);  // CASE SEVEN, timed only
+ *   void bench_xp_mtx_default(const char *name);  // CASE TEN, process-shared only
+ *
+ * Every lock goes through the same loops with direct calls to its
+ * operations; nothing here is dispatched at run time.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "bench.h"
+#include "bench_handoff.h"
+
+#if !defined(BENCH_LOCK) || !defined(BENCH_LOCK_T)
+#error "Define BENCH_LOCK and BENCH_LOCK_T before including bench_case.h"
+#endif
+
+#ifndef BENCH_CAT
+#define BENCH_CAT_(a, b) a##_##b
+#define BENCH_CAT(a, b) BENCH_CAT_(a, b)
+#endif // BENCH_CAT
+
+#define BENCH_FN(fn) BENCH_CAT(fn, BENCH_LOCK)
+#define BENCH_OP(op) BENCH_CAT(BENCH_LOCK, op)
+
+#ifdef BENCH_LOCK_FIFO
+#define BENCH_FIFO 1
+#else
+#define BENCH_FIFO 0
+#endif
+
+static void *BENCH_FN(thread_fcn_rl)(void *_arg) // remote lock, one of N contending threads
+{
+    uint64_t count = 0;
+    struct bench_thread *arg = (struct bench_thread *)_arg;
+    BENCH_LOCK_T *lock = (BENCH_LOCK_T *)arg->lock;
+    const int *done = arg->done;
+    uint64_t *counter = arg->counter;
+    // here, main thread will lock the mutex once every contender has checked in
+    bench_perf_open(&arg->perf);
+    bench_start_line(arg);
+    uint64_t window = bench_window_start(&arg->start);
+    bench_perf_start(&arg->perf);
+    if (bench_cfg.latency)
+    {
+        struct bench_hist *h = &arg->hist[BENCH_OP_TRYLOCK];
+        while (!bench_stopped(done))
+        {
+            uint64_t t0 = bench_ticks();
+            BENCH_OP(trylock)(lock);
+            bench_hist_record(h, bench_ns_between(t0, bench_ticks()));
+            __atomic_store_n(counter, ++count, __ATOMIC_RELAXED);
+        }
+    }
+    else
+    {
+        while (!bench_stopped(done)) // keep going until main stops you
+        {
+            BENCH_OP(trylock)(lock);
+            __atomic_store_n(counter, ++count, __ATOMIC_RELAXED);
+        }
+    }
+    bench_perf_stop(&arg->perf);
+    bench_perf_close(&arg->perf);
+    bench_window_stop(window, &arg->diff);
+    arg->count = count;
+    return NULL;
+}
+
+static void *BENCH_FN(thread_fcn_cl)(void *_arg) // contended lock, one of N threads taking turns
+{
+    uint64_t count = 0;
+    uint64_t first = 0, last = 0, stop = 0, wait_max = 0, gap_max = 0; // ticks, fairness only
+    uint64_t rng = (uint64_t)(uintptr_t)_arg | 1; // workload draws, distinct per thread
+    struct timespec cpu_start, cpu_end;
+    struct bench_thread *arg = (struct bench_thread *)_arg;
+    BENCH_LOCK_T *lock = (BENCH_LOCK_T *)arg->lock;
+    const int *done = arg->done;
+    uint64_t *counter = arg->counter;
+    bench_perf_open(&arg->perf);
+    bench_start_line(arg);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+    uint64_t window = bench_window_start(&arg->start);
+    bench_perf_start(&arg->perf);
+    if (bench_cfg.latency || bench_cfg.fair)
+    {
+        struct bench_hist *hl = bench_cfg.latency ? &arg->hist[BENCH_OP_LOCK] : NULL;
+        struct bench_hist *hu = bench_cfg.latency ? &arg->hist[BENCH_OP_UNLOCK] : NULL;
+        first = last = bench_ticks();
+        while (!bench_stopped(done))
+        {
+            uint64_t cs = 0, think = 0;
+            if (bench_wl.on)
+            {
+                cs = bench_dist_sample(&bench_wl.cs, &rng);
+                think = bench_dist_sample(&bench_wl.think, &rng);
+            }
+            uint64_t t0 = bench_ticks();
+            BENCH_OP(lock)(lock);
+            uint64_t t1 = bench_ticks(), t1u = t1;
+            if (bench_wl.on)
+            {
+                bench_wl_touch();
+                bench_spin_ns(cs);
+                t1u = bench_ticks();
+            }
+            BENCH_OP(unlock)(lock);
+            uint64_t t2 = bench_ticks();
+            if (hl != NULL)
+            {
+                bench_hist_record(hl, bench_ns_between(t0, t1));
+                bench_hist_record(hu, bench_ns_between(t1u, t2));
+            }
+            if (t1 - t0 > wait_max)
+                wait_max = t1 - t0;
+            if (t1 - last > gap_max)
+                gap_max = t1 - last;
+            last = t1;
+            __atomic_store_n(counter, ++count, __ATOMIC_RELAXED);
+            bench_spin_ns(think);
+        }
+        stop = bench_ticks();
+    }
+    else if (bench_wl.on)
+    {
+        while (!bench_stopped(done))
+        {
+            // draw both lengths up front, so the RNG stays out of the critical section
+            uint64_t cs = bench_dist_sample(&bench_wl.cs, &rng);
+            uint64_t think = bench_dist_sample(&bench_wl.think, &rng);
+            BENCH_OP(lock)(lock);
+            bench_wl_touch();
+            bench_spin_ns(cs);
+            BENCH_OP(unlock)(lock);
+            __atomic_store_n(counter, ++count, __ATOMIC_RELAXED);
+            bench_spin_ns(think);
+        }
+    }
+    else
+    {
+        while (!bench_stopped(done)) // keep going until main stops you
+        {
+            BENCH_OP(lock)(lock);
+            BENCH_OP(unlock)(lock);
+            __atomic_store_n(counter, ++count, __ATOMIC_RELAXED);
+        }
+    }
+    bench_perf_stop(&arg->perf);
+    bench_perf_close(&arg->perf);
+    bench_window_stop(window, &arg->diff);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+    timespec_diff(&cpu_start, &cpu_end, &arg->cpu);
+    arg->count = count;
+    if (stop > first) // in ns; a thread still waiting when the trial stops was starved until then
+    {
+        arg->max_wait = bench_ticks_ns(wait_max);
+        arg->max_gap = bench_ticks_ns(stop - last > gap_max ? stop - last : gap_max);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Runs one timed trial of fcn on n workers sharing a fresh lock,
+ * with the main thread and the workers pinned to the current placement.
+ * The workers are processes if bench_cfg.trial_procs is set.
+ *
+ * @param hold Whether the main thread holds the lock for the whole trial.
+ */
+static void BENCH_FN(bench_trial)(void *(*fcn)(void *), struct bench_thread *thr, pthread_t *threads, int n, int layout, int hold)
+{
+    struct bench_layout lay;
+    bench_cfg.trial_layout = layout;
+    bench_layout_init(&lay, layout, sizeof(BENCH_LOCK_T), thr, n);
+    BENCH_LOCK_T *m = BENCH_NEW(BENCH_LOCK_T, lay.lock);
+    BENCH_OP(init)(m);
+    bench_place_enter();
+    for (int j = 0; j < n; j++)
+        bench_spawn(&lay, fcn, thr, threads, j);
+    bench_wait_ready(&lay, n); // wait until every slave signals ready
+    if (hold)
+        BENCH_OP(lock)(m);
+    bench_go(&lay);
+    bench_trial_sleep();
+    bench_stop(&lay); // trigger slave exit
+    for (int j = 0; j < n; j++)
+        bench_join(&lay, thr, threads, j);
+    if (hold)
+        BENCH_OP(unlock)(m);
+    bench_place_leave();
+    BENCH_OP(destroy)(m);
+    BENCH_DELETE(BENCH_LOCK_T, m);
+    bench_layout_free(&lay);
+}
+
+static struct bench_rate BENCH_FN(bench_rl_n)(const char *name, struct bench_thread *thr, pthread_t *threads, int n, int trials, int layout)
+{
+    struct bench_rate acc = {0, 0};
+    struct bench_skew skew;
+    struct bench_adapt ad;
+    memset(&skew, 0, sizeof(skew));
+    bench_adapt_begin(&ad, trials);
+    while (bench_adapt_more(&ad))
+    {
+        BENCH_FN(bench_trial)(&BENCH_FN(thread_fcn_rl), thr, threads, n, layout, 1);
+        if (bench_adapt_calibrate(&ad, thr, n))
+            continue;
+        bench_report_rl(name, thr, n, &acc);
+        bench_report_perf(name, "rl", thr, n);
+        bench_skew_add(&skew, thr, n);
+        bench_adapt_add(&ad, thr, n);
+    }
+    bench_adapt_end(&ad, name, "rl", n);
+
+    bench_report_skew(name, "rl", n, &skew);
+    if (bench_cfg.latency)
+        bench_report_lat(name, thr, n);
+    acc.ops /= ad.trials;
+    return acc;
+}
+
+static struct bench_rate BENCH_FN(bench_cl_n)(const char *name, struct bench_thread *thr, pthread_t *threads, int n, int trials, int layout)
+{
+    struct bench_rate acc = {0, 0};
+    struct bench_skew skew;
+    struct bench_adapt ad;
+    memset(&skew, 0, sizeof(skew));
+    bench_adapt_begin(&ad, trials);
+    while (bench_adapt_more(&ad))
+    {
+        BENCH_FN(bench_trial)(&BENCH_FN(thread_fcn_cl), thr, threads, n, layout, 0);
+        if (bench_adapt_calibrate(&ad, thr, n))
+            continue;
+        bench_report_cl(name, thr, n, &acc);
+        bench_report_perf(name, "cl", thr, n);
+        if (bench_cfg.fair)
+            bench_report_fair(name, BENCH_FIFO, thr, n);
+        bench_skew_add(&skew, thr, n);
+        bench_adapt_add(&ad, thr, n);
+    }
+    bench_adapt_end(&ad, name, "cl", n);
+
+    bench_report_skew(name, "cl", n, &skew);
+    if (bench_cfg.latency)
+        bench_report_lat(name, thr, n);
+    acc.ops /= ad.trials;
+    acc.cpu /= ad.trials;
+    return acc;
+}
+
+/**
+ * @brief Remote lock: contenders hammer trylock on a lock the main thread holds.
+ *
+ * Runs bench_cfg.trials trials with one contender, or at each count in
+ * bench_cfg.threads contenders.
+ */
+BENCH_UNUSED static struct bench_rate BENCH_FN(bench_rl)(const char *name)
+{
+    if (!bench_selected("rl", name))
+    {
+        struct bench_rate none = {0, 0};
+        return none;
+    }
+    return bench_contended(&BENCH_FN(bench_rl_n), "rl", name, 1, bench_cfg.trials);
+}
+
+/**
+ * @brief Contended lock: threads take turns acquiring and releasing the lock.
+ * With a workload (bench_workload.h), each acquisition runs a critical
+ * section and is followed by think time, and runs are named
+ * "<name> <workload>".
+ *
+ * Runs bench_cfg.cl_trials trials with bench_cfg.cl_threads threads, or at
+ * each count in bench_cfg.threads.
+ */
+BENCH_UNUSED static struct bench_rate BENCH_FN(bench_cl)(const char *name)
+{
+    if (!bench_selected("cl", name))
+    {
+        struct bench_rate none = {0, 0};
+        return none;
+    }
+    if (!bench_wl.on)
+        return bench_contended(&BENCH_FN(bench_cl_n), "cl", name, bench_cfg.cl_threads, bench_cfg.cl_trials);
+
+    char label[256], desc[128];
+    bench_wl_describe(desc, sizeof(desc));
+    snprintf(label, sizeof(label), "%s %s", name, desc);
+    return bench_contended(&BENCH_FN(bench_cl_n), "cl", label, bench_cfg.cl_threads, bench_cfg.cl_trials);
+}
+
+static void *BENCH_FN(thread_fcn_pp)(void *_arg) // ping-pong, ownership passed through lock()
+{
+    uint64_t count = 0;
+    struct bench_thread *arg = (struct bench_thread *)_arg;
+    BENCH_LOCK_T *lock = (BENCH_LOCK_T *)arg->lock;
+    const int *done = arg->done;
+    uint64_t *counter = arg->counter;
+    struct bench_hist *h = &arg->hist[BENCH_OP_LOCK];
+    bench_perf_open(&arg->perf);
+    bench_start_line(arg);
+    uint64_t window = bench_window_start(&arg->start);
+    bench_perf_start(&arg->perf);
+    while (!bench_stopped(done)) // keep going until main stops you
+    {
+        __atomic_add_fetch(&bench_pp->waiting, 1, __ATOMIC_RELAXED);
+        BENCH_OP(lock)(lock);
+        uint64_t now = bench_ticks();
+        __atomic_sub_fetch(&bench_pp->waiting, 1, __ATOMIC_RELAXED);
+        if (bench_pp->owner != arg && bench_pp->stamp != 0) // not our own release coming back
+            bench_hist_record(h, bench_ns_between(bench_pp->stamp, now));
+        __atomic_store_n(&bench_pp->taken, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(counter, ++count, __ATOMIC_RELAXED);
+        bench_pp_await(done);
+        bench_pp->owner = arg;
+        bench_pp->stamp = bench_stopped(done) ? 0 : bench_ticks();
+        __atomic_store_n(&bench_pp->taken, 0, __ATOMIC_RELAXED);
+        BENCH_OP(unlock)(lock);
+        bench_pp_until(&bench_pp->taken, done); // no barging back in: the next owner is someone else
+    }
+    bench_perf_stop(&arg->perf);
+    bench_perf_close(&arg->perf);
+    bench_window_stop(window, &arg->diff);
+    arg->count = count;
+    return NULL;
+}
+
+static struct bench_rate BENCH_FN(bench_pp_n)(const char *name, struct bench_thread *thr, pthread_t *threads, int n, int trials, int layout)
+{
+    struct bench_rate acc = {0, 0};
+    if (n < 2) // nobody to hand over to
+        return acc;
+    int own_hist = thr[0].hist == NULL;
+    if (own_hist)
+        bench_hist_attach(thr, n);
+    if (bench_cfg.trial_procs)
+        bench_pp = (struct bench_pp_state *)bench_shm_alloc(sizeof(*bench_pp));
+    struct bench_adapt ad;
+    bench_adapt_begin(&ad, trials);
+    while (bench_adapt_more(&ad))
+    {
+        memset(bench_pp, 0, sizeof(*bench_pp));
+        BENCH_FN(bench_trial)(&BENCH_FN(thread_fcn_pp), thr, threads, n, layout, 0);
+        if (bench_adapt_calibrate(&ad, thr, n))
+            continue;
+        bench_report_perf(name, "pp", thr, n);
+        bench_adapt_add(&ad, thr, n);
+    }
+    bench_adapt_end(&ad, name, "pp", n);
+    acc.ops = bench_report_pp(name, thr, n, ad.trials);
+    if (bench_pp != &bench_pp_local)
+    {
+        bench_shm_free(bench_pp, sizeof(*bench_pp));
+        bench_pp = &bench_pp_local;
+    }
+    if (own_hist)
+        bench_hist_detach(thr);
+    return acc;
+}
+
+/**
+ * @brief Ping-pong: threads pass the lock to each other through lock(), and
+ * each acquisition right after another thread's release is timed. Runs once
+ * with the waiter likely spinning and once with it likely parked (see
+ * bench_handoff.h). Runs are named "<name> spin" and "<name> park".
+ *
+ * Runs bench_cfg.cl_trials trials with bench_cfg.cl_threads threads (at
+ * least 2), or at each count of 2 or more in bench_cfg.threads.
+ */
+BENCH_UNUSED static void BENCH_FN(bench_pp)(const char *name)
+{
+    if (!bench_selected("pp", name))
+        return;
+    for (int mode = 0; mode < BENCH_PP_NMODES; mode++)
+    {
+        char label[96];
+        bench_pp_mode = mode;
+        snprintf(label, sizeof(label), "%s %s", name, bench_pp_mode_names[mode]);
+        bench_contended(&BENCH_FN(bench_pp_n), "pp", label, bench_cfg.cl_threads > 2 ? bench_cfg.cl_threads : 2, bench_cfg.cl_trials);
+    }
+    bench_pp_mode = BENCH_PP_SPIN;
+}
+
+/**
+ * @brief Runs bench_cfg.trials trials of fcn on a fresh lock and a fresh
+ * thread.
+ *
+ * @return Mean ns per operation, for workers that leave their operation
+ * count and time in count and diff; 0 otherwise.
+ */
+static double BENCH_FN(bench_solo)(const char *name, void *(*fcn)(void *))
+{
+    double ns = 0;
+    struct bench_thread thr;
+    memset(&thr, 0, sizeof(thr));
+    thr.name = name;
+    bench_cfg.trial_layout = bench_cfg.layout;
+    if (bench_cfg.latency)
+        bench_hist_attach(&thr, 1);
+
+    for (int i = 0; i < bench_cfg.trials; i++)
+    {
+        struct bench_layout lay;
+        pthread_t thread;
+        bench_layout_init(&lay, bench_cfg.layout, sizeof(BENCH_LOCK_T), &thr, 1);
+        BENCH_LOCK_T *m = BENCH_NEW(BENCH_LOCK_T, lay.lock);
+        BENCH_OP(init)(m);
+        thr.count = 0;
+        pthread_create(&thread, NULL, fcn, &thr);
+        pthread_join(thread, NULL);
+        if (thr.count > 0)
+            ns += timespec_sec(&thr.diff) * 1e9 / thr.count / bench_cfg.trials;
+        BENCH_OP(destroy)(m);
+        BENCH_DELETE(BENCH_LOCK_T, m);
+        bench_layout_free(&lay);
+    }
+
+    if (bench_cfg.latency)
+    {
+        bench_report_lat(name, &thr, 1);
+        bench_hist_detach(&thr);
+    }
+    return ns;
+}
+
+static void *BENCH_FN(thread_fcn_ul)(void *_arg) // uncontended lock/unlock pairs
+{
+    uint64_t i_, i;
+    i_ = i = bench_cfg.sl_iterations;
+    struct timespec start, diff;
+    struct bench_thread *arg = (struct bench_thread *)_arg;
+    BENCH_LOCK_T *lock = (BENCH_LOCK_T *)arg->lock;
+
+    bench_perf_open(&arg->perf);
+    uint64_t window = bench_window_start(&start);
+    bench_perf_start(&arg->perf);
+    if (bench_cfg.latency)
+    {
+        struct bench_hist *hl = &arg->hist[BENCH_OP_LOCK];
+        struct bench_hist *hu = &arg->hist[BENCH_OP_UNLOCK];
+        while (i--)
+        {
+            uint64_t t0 = bench_ticks();
+            BENCH_OP(lock)(lock);
+            uint64_t t1 = bench_ticks();
+            BENCH_OP(unlock)(lock);
+            uint64_t t2 = bench_ticks();
+            bench_hist_record(hl, bench_ns_between(t0, t1));
+            bench_hist_record(hu, bench_ns_between(t1, t2));
+        }
+    }
+    else
+    {
+        while (i--)
+        {
+            BENCH_OP(lock)(lock);
+            BENCH_OP(unlock)(lock);
+        }
+    }
+    bench_perf_stop(&arg->perf);
+    bench_perf_close(&arg->perf);
+    bench_window_stop(window, &diff);
+    bprintlf(BLUE_FG "[%s] Lock/Unlock Pairs: %" PRIu64 " in %ld.%09ld s", arg->name, i_, diff.tv_sec, diff.tv_nsec);
+    if (!bench_cfg.ul_quiet)
+        fprintf(bench_fopen(&bench_out.ul, "ul"), "%s, %ld.%09ld, %" PRIu64 ", %ld.%09ld\n", arg->name, start.tv_sec, start.tv_nsec, i_, diff.tv_sec, diff.tv_nsec);
+    bench_bin_solo(arg->name, "ul", i_, &start, &diff);
+    arg->count = i_;
+    arg->diff = diff;
+    bench_report_perf(arg->name, "ul", arg, 1);
+    return NULL;
+}
+
+/**
+ * @brief Uncontended: one thread takes and releases a free lock.
+ *
+ * @return Mean ns per lock/unlock pair.
+ */
+BENCH_UNUSED static double BENCH_FN(bench_ul)(const char *name)
+{
+    if (!bench_selected("ul", name))
+        return 0;
+    return BENCH_FN(bench_solo)(name, &BENCH_FN(thread_fcn_ul));
+}
+
+#ifdef BENCH_LOCK_RECURSIVE
+
+static void *BENCH_FN(thread_fcn_sl)(void *_arg) // self lock, only on recursive
+{
+    uint64_t i_, i;
+    i_ = i = bench_cfg.sl_iterations;
+    struct timespec start, diff;
+    struct bench_thread *arg = (struct bench_thread *)_arg;
+    BENCH_LOCK_T *lock = (BENCH_LOCK_T *)arg->lock;
+
+    uint64_t t0 = bench_ticks();
+    BENCH_OP(lock)(lock); // lock your recursive mutex
+    if (bench_cfg.latency)
+        bench_hist_record(&arg->hist[BENCH_OP_LOCK], bench_ns_between(t0, bench_ticks()));
+    bench_perf_open(&arg->perf);
+    uint64_t window = bench_window_start(&start);
+    bench_perf_start(&arg->perf);
+    if (bench_cfg.latency)
+    {
+        struct bench_hist *h = &arg->hist[BENCH_OP_TRYLOCK];
+        while (i--)
+        {
+            t0 = bench_ticks();
+            BENCH_OP(trylock)(lock);
+            bench_hist_record(h, bench_ns_between(t0, bench_ticks()));
+        }
+    }
+    else
+    {
+        while (i--)
+        {
+            BENCH_OP(trylock)(lock);
+        }
+    }
+    bench_perf_stop(&arg->perf);
+    bench_window_stop(window, &diff);
+    bprintlf(BLUE_FG "[%s] Lock Attempts: %" PRIu64 " in %ld.%09ld s", arg->name, i_, diff.tv_sec, diff.tv_nsec);
+    fprintf(bench_fopen(&bench_out.sl_locks, "sl_locks"), "%s, %ld.%09ld, %" PRIu64 ", %ld.%09ld\n", arg->name, start.tv_sec, start.tv_nsec, i_, diff.tv_sec, diff.tv_nsec);
+    bench_bin_solo(arg->name, "sl_locks", i_, &start, &diff);
+    arg->count = i_;
+    bench_report_perf(arg->name, "sl_locks", arg, 1);
+
+    i = i_;
+    window = bench_window_start(&start);
+    bench_perf_start(&arg->perf);
+    if (bench_cfg.latency)
+    {
+        struct bench_hist *h = &arg->hist[BENCH_OP_UNLOCK];
+        while (i--)
+        {
+            t0 = bench_ticks();
+            BENCH_OP(unlock)(lock);
+            bench_hist_record(h, bench_ns_between(t0, bench_ticks()));
+        }
+    }
+    else
+    {
+        while (i--)
+        {
+            BENCH_OP(unlock)(lock);
+        }
+    }
+    BENCH_OP(unlock)(lock);
+    bench_perf_stop(&arg->perf);
+    bench_perf_close(&arg->perf);
+    bench_window_stop(window, &diff);
+    bprintlf(BLUE_FG "[%s] Unlock Attempts: %" PRIu64 " in %ld.%09ld s", arg->name, i_, diff.tv_sec, diff.tv_nsec);
+    fprintf(bench_fopen(&bench_out.sl_unlocks, "sl_unlocks"), "%s, %ld.%09ld, %" PRIu64 ", %ld.%09ld\n", arg->name, start.tv_sec, start.tv_nsec, i_, diff.tv_sec, diff.tv_nsec);
+    bench_bin_solo(arg->name, "sl_unlocks", i_, &start, &diff);
+    bench_report_perf(arg->name, "sl_unlocks", arg, 1);
+    return NULL;
+}
+
+/**
+ * @brief Self lock: one thread re-locks its own recursive lock, then unwinds.
+ */
+BENCH_UNUSED static void BENCH_FN(bench_sl)(const char *name)
+{
+    if (!bench_selected("sl", name))
+        return;
+    BENCH_FN(bench_solo)(name, &BENCH_FN(thread_fcn_sl));
+}
+
+static void *BENCH_FN(thread_fcn_depth)(void *_arg) // re-lock cost by recursion depth, only on recursive
+{
+    struct bench_thread *arg = (struct bench_thread *)_arg;
+    BENCH_LOCK_T *lock = (BENCH_LOCK_T *)arg->lock;
+
+    BENCH_OP(lock)(lock); // held throughout, so every lock below is a re-lock
+    for (size_t k = 0; k < sizeof(bench_depths) / sizeof(bench_depths[0]); k++)
+    {
+        const int depth = bench_depths[k];
+        const uint64_t rounds = DEPTH_OPS / depth;
+        uint64_t lock_ticks = 0, unlock_ticks = 0;
+        for (uint64_t r = rounds; r--;)
+        {
+            uint64_t t0 = bench_ticks();
+            for (int j = depth; j--;)
+                BENCH_OP(lock)(lock);
+            uint64_t t1 = bench_ticks();
+            for (int j = depth; j--;)
+                BENCH_OP(unlock)(lock);
+            uint64_t t2 = bench_ticks();
+            lock_ticks += bench_ticks_sub(t1, t0);
+            unlock_ticks += bench_ticks_sub(t2, t1);
+        }
+        double ops = (double)rounds * depth;
+        bench_report_depth(arg->name, depth, lock_ticks * bench_clk.ns_per_tick / ops, unlock_ticks * bench_clk.ns_per_tick / ops);
+    }
+    BENCH_OP(unlock)(lock);
+    return NULL;
+}
+
+/**
+ * @brief Recursion depth: with the lock already held, one thread re-locks
+ * it depth times and unwinds, over and over, for each depth in
+ * bench_depths. Reports the mean cost of one re-lock and of one unlock at
+ * each depth, with the timer's own overhead taken out (bench_clock.h).
+ */
+BENCH_UNUSED static void BENCH_FN(bench_depth)(const char *name)
+{
+    if (!bench_selected("depth", name))
+        return;
+    struct bench_thread thr;
+    struct bench_layout lay;
+    pthread_t thread;
+    memset(&thr, 0, sizeof(thr));
+    thr.name = name;
+    bench_cfg.trial_layout = bench_cfg.layout;
+    bench_layout_init(&lay, bench_cfg.layout, sizeof(BENCH_LOCK_T), &thr, 1);
+    BENCH_LOCK_T *m = BENCH_NEW(BENCH_LOCK_T, lay.lock);
+    BENCH_OP(init)(m);
+    pthread_create(&thread, NULL, &BENCH_FN(thread_fcn_depth), &thr);
+    pthread_join(thread, NULL);
+    BENCH_OP(destroy)(m);
+    BENCH_DELETE(BENCH_LOCK_T, m);
+    bench_layout_free(&lay);
+}
+
+#endif // BENCH_LOCK_RECURSIVE
+
+#ifdef BENCH_LOCK_TIMED
+
+#include "bench_timed.h"
+
+static void *BENCH_FN(thread_fcn_tl)(void *_arg) // uncontended lock and timedlock pairs
+{
+    const uint64_t iters = bench_cfg.sl_iterations;
+    uint64_t i, start;
+    double lock_ns, timed_ns[BENCH_TL_NCLOCKS];
+    struct bench_thread *arg = (struct bench_thread *)_arg;
+    BENCH_LOCK_T *lock = (BENCH_LOCK_T *)arg->lock;
+
+    start = bench_ticks();
+    for (i = iters; i--;)
+    {
+        BENCH_OP(lock)(lock);
+        BENCH_OP(unlock)(lock);
+    }
+    lock_ns = (double)bench_ns_between(start, bench_ticks()) / iters;
+
+    for (int c = 0; c < BENCH_TL_NCLOCKS; c++)
+    {
+        struct timespec deadline; // far enough out that it never passes
+        clock_gettime(bench_tl_clocks[c], &deadline);
+        deadline.tv_sec += 3600;
+        start = bench_ticks();
+        for (i = iters; i--;)
+        {
+            BENCH_OP(timedlock)(lock, bench_tl_clocks[c], &deadline);
+            BENCH_OP(unlock)(lock);
+        }
+        timed_ns[c] = (double)bench_ns_between(start, bench_ticks()) / iters;
+    }
+    bench_report_tl_cost(arg->name, lock_ns, timed_ns);
+    return NULL;
+}
+
+static void *BENCH_FN(thread_fcn_tl_overshoot)(void *_arg) // timed attempts on a lock the main thread holds
+{
+    struct bench_thread *arg = (struct bench_thread *)_arg;
+    BENCH_LOCK_T *lock = (BENCH_LOCK_T *)arg->lock;
+    struct bench_hist *h = arg->hist;
+
+    for (int c = 0; c < BENCH_TL_NCLOCKS; c++)
+    {
+        for (size_t t = 0; t < sizeof(bench_tl_timeouts) / sizeof(bench_tl_timeouts[0]); t++)
+        {
+            uint64_t early = 0, acquired = 0;
+            bench_hist_reset(h);
+            for (uint64_t i = bench_tl_samples(bench_tl_timeouts[t]); i--;)
+            {
+                struct timespec deadline;
+                uint64_t t0 = bench_ticks(); // before the deadline is read, so the wait is never undercounted
+                clock_gettime(bench_tl_clocks[c], &deadline);
+                timespec_add_ns(&deadline, bench_tl_timeouts[t]);
+                int ret = BENCH_OP(timedlock)(lock, bench_tl_clocks[c], &deadline);
+                uint64_t t1 = bench_ticks();
+                if (ret == 0)
+                {
+                    acquired++;
+                    BENCH_OP(unlock)(lock);
+                    continue;
+                }
+                int64_t over = (int64_t)bench_ns_between(t0, t1) - (int64_t)bench_tl_timeouts[t];
+                if (over < 0)
+                    early++;
+                else
+                    bench_hist_record(h, (uint64_t)over);
+            }
+            bench_report_tl_overshoot(arg->name, c, bench_tl_timeouts[t], h, early, acquired);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Timed lock: the uncontended cost of timedlock against lock, then
+ * how far past the deadline timedlock returns on a lock held by the main
+ * thread, for each clock and timeout.
+ */
+BENCH_UNUSED static void BENCH_FN(bench_tl)(const char *name)
+{
+    if (!bench_selected("tl", name))
+        return;
+    BENCH_FN(bench_solo)(name, &BENCH_FN(thread_fcn_tl));
+
+    struct bench_thread thr;
+    struct bench_layout lay;
+    pthread_t thread;
+    memset(&thr, 0, sizeof(thr));
+    thr.name = name;
+    thr.hist = bench_hist_alloc(1);
+    if (thr.hist == NULL)
+    {
+        dbprintlf(FATAL "Failed to allocate a histogram.");
+        exit(4);
+    }
+    bench_cfg.trial_layout = bench_cfg.layout;
+    bench_layout_init(&lay, bench_cfg.layout, sizeof(BENCH_LOCK_T), &thr, 1);
+    BENCH_LOCK_T *m = BENCH_NEW(BENCH_LOCK_T, lay.lock);
+    BENCH_OP(init)(m);
+    BENCH_OP(lock)(m);
+    pthread_create(&thread, NULL, &BENCH_FN(thread_fcn_tl_overshoot), &thr);
+    pthread_join(thread, NULL);
+    BENCH_OP(unlock)(m);
+    BENCH_OP(destroy)(m);
+    BENCH_DELETE(BENCH_LOCK_T, m);
+    bench_layout_free(&lay);
+    free(thr.hist);
+}
+
+#endif // BENCH_LOCK_TIMED
+
+#ifdef BENCH_LOCK_PSHARED
+
+static struct bench_rate BENCH_FN(bench_rl_xp_n)(const char *name, struct bench_thread *thr, pthread_t *threads, int n, int trials, int layout)
+{
+    return bench_procs_point(&BENCH_FN(bench_rl_n), "rl", name, thr, threads, n, trials, layout);
+}
+
+static struct bench_rate BENCH_FN(bench_pp_xp_n)(const char *name, struct bench_thread *thr, pthread_t *threads, int n, int trials, int layout)
+{
+    return bench_procs_point(&BENCH_FN(bench_pp_n), "pp", name, thr, threads, n, trials, layout);
+}
+
+/**
+ * @brief Cross-process: the remote-lock and ping-pong cases with the lock
+ * in shared memory, run with threads and then with forked processes, and
+ * the process overhead reported for each.
+ *
+ * Runs bench_cfg.cl_trials trials of each with one contender and
+ * bench_cfg.cl_threads threads (at least 2) respectively, or at each count
+ * in bench_cfg.threads.
+ */
+BENCH_UNUSED static void BENCH_FN(bench_xp)(const char *name)
+{
+    if (!bench_selected("xp", name))
+        return;
+    bench_contended(&BENCH_FN(bench_rl_xp_n), "rl", name, 1, bench_cfg.cl_trials);
+    for (int mode = 0; mode < BENCH_PP_NMODES; mode++)
+    {
+        char label[96];
+        bench_pp_mode = mode;
+        snprintf(label, sizeof(label), "%s %s", name, bench_pp_mode_names[mode]);
+        bench_contended(&BENCH_FN(bench_pp_xp_n), "pp", label, bench_cfg.cl_threads > 2 ? bench_cfg.cl_threads : 2, bench_cfg.cl_trials);
+    }
+    bench_pp_mode = BENCH_PP_SPIN;
+}
+
+#endif // BENCH_LOCK_PSHARED
+
+#undef BENCH_FN
+#undef BENCH_OP
+#undef BENCH_FIFO
+#undef BENCH_LOCK
+#undef BENCH_LOCK_T
+#undef BENCH_LOCK_RECURSIVE
+#undef BENCH_LOCK_TIMED
+#undef BENCH_LOCK_FIFO
+#undef BENCH_LOCK_PSHARED
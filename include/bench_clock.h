@@ -0,0 +1,216 @@
+/**
+ * @file bench_clock.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Calibrated interval timer for timed windows and per-operation samples.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * Intervals are read from one of two sources:
+ *
+ *   tsc  the invariant time-stamp counter through rdtscp (the virtual
+ *        counter on AArch64), converted with a rate measured against
+ *        CLOCK_MONOTONIC at start-up
+ *   raw  CLOCK_MONOTONIC_RAW, in ns, free of NTP slew
+ *
+ * bench_clock_init() also measures the least number of ticks between two
+ * back-to-back reads. That overhead is taken out of every interval, so a
+ * sample covers the timed operation and not the timer.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_CLOCK_H
+#define BENCH_CLOCK_H
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+
+#ifndef BENCH_CLOCK_CAL_NS
+#define BENCH_CLOCK_CAL_NS 50000000 // how long the tsc source is calibrated against CLOCK_MONOTONIC
+#endif
+
+enum bench_clock_source
+{
+    BENCH_CLOCK_TSC,
+    BENCH_CLOCK_RAW,
+    BENCH_CLOCK_NSOURCES,
+};
+
+static const char *const bench_clock_names[BENCH_CLOCK_NSOURCES] = {"tsc", "raw"};
+
+/**
+ * @brief The interval timer in use, set up by bench_clock_init().
+ */
+static struct
+{
+    int source;         // enum bench_clock_source
+    double ns_per_tick;
+    uint64_t overhead;  // ticks between two back-to-back reads, at best
+} bench_clk = {BENCH_CLOCK_RAW, 1.0, 0};
+
+/**
+ * @brief Whether the time-stamp counter runs at a constant rate through
+ * frequency changes and idle states, and rdtscp is available.
+ */
+static inline int bench_tsc_invariant(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned a, b, c, d;
+    if (__get_cpuid(0x80000001, &a, &b, &c, &d) == 0 || !(d & (1u << 27))) // rdtscp
+        return 0;
+    if (__get_cpuid(0x80000007, &a, &b, &c, &d) == 0)
+        return 0;
+    return (d >> 8) & 1;
+#elif defined(__aarch64__)
+    return 1; // the generic timer's virtual counter has a fixed frequency
+#else
+    return 0;
+#endif
+}
+
+static inline uint64_t bench_clock_raw_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Reads the interval timer, in ticks of the current source.
+ *
+ * rdtscp waits for every earlier instruction to finish, so a read right
+ * after an operation is not taken before the operation completes.
+ */
+static inline uint64_t bench_ticks(void)
+{
+    if (bench_clk.source == BENCH_CLOCK_TSC)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned aux;
+        return __rdtscp(&aux);
+#elif defined(__aarch64__)
+        uint64_t v;
+        __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(v)::"memory");
+        return v;
+#endif
+    }
+    return bench_clock_raw_ns();
+}
+
+/**
+ * @brief Ticks from t0 to t1, less the timer's own overhead.
+ */
+static inline uint64_t bench_ticks_sub(uint64_t t1, uint64_t t0)
+{
+    uint64_t d = t1 - t0;
+    return d > bench_clk.overhead ? d - bench_clk.overhead : 0;
+}
+
+static inline uint64_t bench_ticks_ns(uint64_t ticks)
+{
+    return (uint64_t)(ticks * bench_clk.ns_per_tick + 0.5);
+}
+
+/**
+ * @brief Nanoseconds from t0 to t1, less the timer's own overhead.
+ */
+static inline uint64_t bench_ns_between(uint64_t t0, uint64_t t1)
+{
+    return bench_ticks_ns(bench_ticks_sub(t1, t0));
+}
+
+/**
+ * @brief Starts a timed window: stamps start with CLOCK_REALTIME, to place
+ * the window in the result files, and returns the interval timer.
+ */
+static inline uint64_t bench_window_start(struct timespec *start)
+{
+    clock_gettime(CLOCK_REALTIME, start);
+    return bench_ticks();
+}
+
+/**
+ * @brief Ends a timed window begun at t0 and stores its length in diff.
+ */
+static inline void bench_window_stop(uint64_t t0, struct timespec *diff)
+{
+    uint64_t ns = bench_ns_between(t0, bench_ticks());
+    diff->tv_sec = (time_t)(ns / 1000000000ULL);
+    diff->tv_nsec = (long)(ns % 1000000000ULL);
+}
+
+/**
+ * @brief Selects the interval timer, falling back to raw without an
+ * invariant TSC, then calibrates it and measures its overhead.
+ *
+ * @return The source in use.
+ */
+static inline int bench_clock_init(int source)
+{
+    if (source == BENCH_CLOCK_TSC && !bench_tsc_invariant())
+        source = BENCH_CLOCK_RAW;
+    bench_clk.source = source;
+    bench_clk.ns_per_tick = 1.0;
+    bench_clk.overhead = 0;
+
+    if (source == BENCH_CLOCK_TSC)
+    {
+        struct timespec a, b;
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        uint64_t t0 = bench_ticks();
+        uint64_t until = (uint64_t)a.tv_sec * 1000000000ULL + a.tv_nsec + BENCH_CLOCK_CAL_NS;
+        do
+            clock_gettime(CLOCK_MONOTONIC, &b);
+        while ((uint64_t)b.tv_sec * 1000000000ULL + b.tv_nsec < until);
+        uint64_t t1 = bench_ticks();
+        double ns = (double)(b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec);
+        if (t1 > t0)
+            bench_clk.ns_per_tick = ns / (t1 - t0);
+    }
+
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 10000; i++)
+    {
+        uint64_t t0 = bench_ticks();
+        uint64_t t1 = bench_ticks();
+        if (t1 - t0 < best)
+            best = t1 - t0;
+    }
+    bench_clk.overhead = best;
+    return source;
+}
+
+/**
+ * @brief Parses a source name.
+ *
+ * @return The source, or -1 if name is not one.
+ */
+static inline int bench_clock_parse(const char *name)
+{
+    for (int i = 0; i < BENCH_CLOCK_NSOURCES; i++)
+        if (strcmp(name, bench_clock_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+#endif // BENCH_CLOCK_H
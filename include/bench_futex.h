@@ -0,0 +1,102 @@
+/**
+ * @file bench_futex.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Futex mutex cases and the spin-budget sweep.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * Instantiates bench_case.h for futex_mutex_t as fmtx. Every fmtx lock
+ * picks up the spin budget in fmtx_spin_iters / fmtx_spin_ns when it is
+ * initialized, so the budget is fixed for the whole trial.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_FUTEX_H
+#define BENCH_FUTEX_H
+
+#include "bench.h"
+#include "futex_mutex.h"
+
+static uint32_t fmtx_spin_iters = FUTEX_SPIN_DEFAULT;
+static uint64_t fmtx_spin_ns = 0;
+
+static inline void fmtx_init(futex_mutex_t *m) { futex_mutex_init(m, fmtx_spin_iters, fmtx_spin_ns); }
+static inline void fmtx_destroy(futex_mutex_t *m) { futex_mutex_destroy(m); }
+static inline void fmtx_lock(futex_mutex_t *m) { futex_mutex_lock(m); }
+static inline int fmtx_trylock(futex_mutex_t *m) { return futex_mutex_trylock(m); }
+static inline void fmtx_unlock(futex_mutex_t *m) { futex_mutex_unlock(m); }
+
+#define BENCH_LOCK fmtx
+#define BENCH_LOCK_T futex_mutex_t
+#include "bench_case.h"
+
+/**
+ * @brief Spin budgets swept by bench_futex_spin_sweep(), as polls or as ns.
+ */
+static const uint32_t fmtx_sweep_iters[] = {0, 64, 512, 4096, 32768};
+static const uint64_t fmtx_sweep_ns[] = {1000, 10000, 100000};
+
+/**
+ * @brief Runs the contended-lock case for each spin budget and reports the
+ * budget with the best throughput and the one with the most acquisitions
+ * per CPU-second.
+ */
+static inline void bench_futex_spin_sweep(void)
+{
+    const int n_iters = sizeof(fmtx_sweep_iters) / sizeof(fmtx_sweep_iters[0]);
+    const int n_ns = sizeof(fmtx_sweep_ns) / sizeof(fmtx_sweep_ns[0]);
+    char name[64], best_ops_name[64] = "", best_eff_name[64] = "";
+    double best_ops = 0, best_eff = 0;
+
+    for (int i = 0; i < n_iters + n_ns; i++)
+    {
+        if (i < n_iters)
+        {
+            fmtx_spin_iters = fmtx_sweep_iters[i];
+            fmtx_spin_ns = 0;
+            snprintf(name, sizeof(name), "FUTEX spin=%" PRIu32, fmtx_spin_iters);
+        }
+        else
+        {
+            fmtx_spin_ns = fmtx_sweep_ns[i - n_iters];
+            snprintf(name, sizeof(name), "FUTEX spin=%" PRIu64 "ns", fmtx_spin_ns);
+        }
+
+        struct bench_rate r = bench_cl_fmtx(name);
+        double eff = r.cpu > 0 ? r.ops / r.cpu : 0;
+        if (r.ops > best_ops)
+        {
+            best_ops = r.ops;
+            strcpy(best_ops_name, name);
+        }
+        if (eff > best_eff)
+        {
+            best_eff = eff;
+            strcpy(best_eff_name, name);
+        }
+    }
+    fmtx_spin_iters = FUTEX_SPIN_DEFAULT;
+    fmtx_spin_ns = 0;
+    if (best_ops == 0) // none selected
+        return;
+
+    bprintlf(GREEN_FG "Best throughput: %s (%.0f acquisitions/s)", best_ops_name, best_ops);
+    bprintlf(GREEN_FG "Best efficiency: %s (%.0f acquisitions per CPU-second)", best_eff_name, best_eff);
+}
+
+#endif // BENCH_FUTEX_H
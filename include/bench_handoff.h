@@ -0,0 +1,153 @@
+/**
+ * @file bench_handoff.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Shared pieces of the ping-pong handoff case (bench_pp_* in bench_case.h).
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_HANDOFF_H
+#define BENCH_HANDOFF_H
+
+#include <sched.h>
+#include "bench.h"
+
+#ifndef PP_PARK_NS
+#define PP_PARK_NS 200000 // how long the holder waits in park mode, long enough for a waiter to sleep
+#endif
+#ifndef PP_SPINS
+#define PP_SPINS 1024 // polls for a waiter before the holder starts yielding
+#endif
+
+/**
+ * @brief Handoff modes: the holder releases as soon as another thread is
+ * waiting, or PP_PARK_NS later.
+ */
+enum bench_pp_mode
+{
+    BENCH_PP_SPIN,
+    BENCH_PP_PARK,
+    BENCH_PP_NMODES,
+};
+
+static const char *const bench_pp_mode_names[BENCH_PP_NMODES] = {"spin", "park"};
+
+/**
+ * @brief Trial state besides the lock. stamp and owner are only touched
+ * with the lock held.
+ */
+struct bench_pp_state
+{
+    int waiting;       // threads between announcing themselves and acquiring
+    int taken;         // set by the first other thread to acquire after a release
+    uint64_t stamp;    // bench_ticks() at the last release, 0 if none
+    const void *owner; // thread that made the last release
+} __attribute__((aligned(BENCH_CACHELINE)));
+
+static struct bench_pp_state bench_pp_local;
+static struct bench_pp_state *bench_pp = &bench_pp_local; // in shared memory while the workers are processes
+
+static int bench_pp_mode = BENCH_PP_SPIN; // mode of the trials being run
+
+static inline uint64_t bench_pp_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return timespec_ns(&ts);
+}
+
+/**
+ * @brief Waits until *v is nonzero or the trial is stopped, yielding after
+ * PP_SPINS polls since the thread it waits for may need this CPU.
+ */
+static inline void bench_pp_until(const int *v, const int *done)
+{
+    for (int spins = 0; __atomic_load_n(v, __ATOMIC_RELAXED) == 0 && !bench_stopped(done); spins++)
+    {
+        if (spins < PP_SPINS)
+            cpu_relax();
+        else
+            sched_yield();
+    }
+}
+
+/**
+ * @brief In park mode, holds on for PP_PARK_NS so that a waiter that ever
+ * sleeps has gone to sleep.
+ */
+static inline void bench_pp_park(void)
+{
+    if (bench_pp_mode == BENCH_PP_PARK)
+    {
+        uint64_t until = bench_pp_now() + PP_PARK_NS;
+        while (bench_pp_now() < until)
+            cpu_relax();
+    }
+}
+
+/**
+ * @brief Holds on until another thread has announced it is about to lock,
+ * so the next release is a handoff, then, in park mode, for PP_PARK_NS
+ * more so that the waiter has gone to sleep if its lock ever does.
+ */
+static inline void bench_pp_await(const int *done)
+{
+    bench_pp_until(&bench_pp->waiting, done);
+    bench_pp_park();
+}
+
+/**
+ * @brief Prints and records the handoff latency of a run of trials at n
+ * threads, from the per-thread histograms in hist[BENCH_OP_LOCK], and
+ * resets them.
+ *
+ * @return Handoffs per second, averaged over the trials.
+ */
+static inline double bench_report_pp(const char *name, struct bench_thread *thr, int n, int trials)
+{
+    struct bench_hist *total = bench_hist_alloc(1);
+    if (total == NULL)
+        return 0;
+    double wall = 0;
+    for (int j = 0; j < n; j++)
+    {
+        bench_hist_merge(total, &thr[j].hist[BENCH_OP_LOCK]);
+        bench_hist_reset(&thr[j].hist[BENCH_OP_LOCK]);
+        double sec = timespec_sec(&thr[j].diff);
+        if (sec > wall)
+            wall = sec;
+    }
+    double rate = total->count / (wall * trials);
+    uint64_t p50 = bench_hist_quantile(total, 0.50);
+    uint64_t p99 = bench_hist_quantile(total, 0.99);
+    uint64_t p999 = bench_hist_quantile(total, 0.999);
+    uint64_t max = total->count ? total->max : 0;
+    char kind[16];
+    snprintf(kind, sizeof(kind), "pp_%s", bench_pp_mode_names[bench_pp_mode]);
+
+    bprintlf(CYAN_FG "[%s] Threads: %d | Handoffs: %.0f /s | Unlock to acquire: p50 %" PRIu64 " | p99 %" PRIu64 " | p99.9 %" PRIu64 " | max %" PRIu64 " ns",
+             name, n, rate, p50, p99, p999, max);
+    fprintf(bench_fopen(&bench_out.pp, "pp"), "%s, %s, %d, %.0f, %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 "\n",
+            name, bench_pp_mode_names[bench_pp_mode], n, rate, p50, p99, p999, max);
+    bench_bin_buckets(name, kind, "ns", n, total);
+    free(total);
+    return rate;
+}
+
+#endif // BENCH_HANDOFF_H
@@ -0,0 +1,140 @@
+/**
+ * @file bench_hist.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Log-bucketed (HDR-style) latency histogram.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * Values are bucketed by their highest set bit and then split into
+ * 2^BENCH_HIST_SUB_BITS linear sub-buckets, so every bucket is within
+ * about 3% of the values it holds, over the full 64-bit range, in a fixed
+ * amount of memory. Histograms are allocated once per thread, aligned to
+ * a cache line, and only merged after the workers are joined.
+ *
+ * Compiles as both C and C++.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_HIST_H
+#define BENCH_HIST_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_HIST_SUB_BITS 5
+#define BENCH_HIST_SUB_COUNT (1 << BENCH_HIST_SUB_BITS)
+#define BENCH_HIST_BUCKETS ((64 - BENCH_HIST_SUB_BITS + 1) << BENCH_HIST_SUB_BITS)
+
+struct bench_hist
+{
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[BENCH_HIST_BUCKETS];
+} __attribute__((aligned(64)));
+
+static inline void bench_hist_reset(struct bench_hist *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+/**
+ * @brief Allocates n cache-line aligned, reset histograms.
+ */
+static inline struct bench_hist *bench_hist_alloc(int n)
+{
+    void *mem = NULL;
+    if (posix_memalign(&mem, 64, n * sizeof(struct bench_hist)) != 0)
+        return NULL;
+    struct bench_hist *h = (struct bench_hist *)mem;
+    for (int i = 0; i < n; i++)
+        bench_hist_reset(&h[i]);
+    return h;
+}
+
+static inline int bench_hist_index(uint64_t v)
+{
+    if (v < BENCH_HIST_SUB_COUNT)
+        return (int)v;
+    int e = 63 - __builtin_clzll(v);
+    int block = e - BENCH_HIST_SUB_BITS + 1;
+    return (block << BENCH_HIST_SUB_BITS) | (int)((v >> (block - 1)) & (BENCH_HIST_SUB_COUNT - 1));
+}
+
+/**
+ * @brief Highest value that lands in bucket idx.
+ */
+static inline uint64_t bench_hist_value(int idx)
+{
+    if (idx < BENCH_HIST_SUB_COUNT)
+        return (uint64_t)idx;
+    int block = idx >> BENCH_HIST_SUB_BITS;
+    uint64_t sub = (uint64_t)(idx & (BENCH_HIST_SUB_COUNT - 1));
+    uint64_t lower = (BENCH_HIST_SUB_COUNT | sub) << (block - 1);
+    return lower + ((1ULL << (block - 1)) - 1);
+}
+
+static inline void bench_hist_record(struct bench_hist *h, uint64_t v)
+{
+    h->buckets[bench_hist_index(v)]++;
+    h->count++;
+    if (v < h->min)
+        h->min = v;
+    if (v > h->max)
+        h->max = v;
+}
+
+static inline void bench_hist_merge(struct bench_hist *dst, const struct bench_hist *src)
+{
+    if (src->count == 0)
+        return;
+    for (int i = 0; i < BENCH_HIST_BUCKETS; i++)
+        dst->buckets[i] += src->buckets[i];
+    dst->count += src->count;
+    if (src->min < dst->min)
+        dst->min = src->min;
+    if (src->max > dst->max)
+        dst->max = src->max;
+}
+
+/**
+ * @brief Value at quantile q (0..1), reported as its bucket's upper bound.
+ */
+static inline uint64_t bench_hist_quantile(const struct bench_hist *h, double q)
+{
+    if (h->count == 0)
+        return 0;
+    uint64_t rank = (uint64_t)(q * h->count);
+    if (rank >= h->count)
+        rank = h->count - 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BENCH_HIST_BUCKETS; i++)
+    {
+        seen += h->buckets[i];
+        if (seen > rank)
+        {
+            uint64_t v = bench_hist_value(i);
+            return v > h->max ? h->max : v;
+        }
+    }
+    return h->max;
+}
+
+#endif // BENCH_HIST_H
@@ -0,0 +1,265 @@
+/**
+ * @file bench_locks.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Lock adapters for bench_case.h.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * Each lock is a type plus init/destroy/lock/trylock/unlock functions named
+ * after it; reader-writer locks have init/destroy/rdlock/rdunlock/wrlock/
+ * wrunlock instead. The std:: adapters are only available when compiled
+ * as C++.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_LOCKS_H
+#define BENCH_LOCKS_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // PTHREAD_MUTEX_ADAPTIVE_NP
+#endif
+
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include "meb_print.h"
+#include "spinlock.h"
+#include "seqlock.h"
+#include "owner_mutex.h"
+
+/**
+ * @brief pthread_mutex_timedlock() for CLOCK_REALTIME deadlines and
+ * pthread_mutex_clocklock() (glibc 2.30) for CLOCK_MONOTONIC ones.
+ *
+ * @return 0, ETIMEDOUT, or EINVAL if the C library cannot wait on clock.
+ */
+static inline int mtx_timedlock(pthread_mutex_t *m, clockid_t clock, const struct timespec *abs)
+{
+    if (clock == CLOCK_REALTIME)
+        return pthread_mutex_timedlock(m, abs);
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 30))
+    return pthread_mutex_clocklock(m, clock, abs);
+#else
+    return EINVAL;
+#endif
+}
+
+// PTHREAD_MUTEX_DEFAULT
+static inline void mtx_default_init(pthread_mutex_t *m)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_DEFAULT);
+    pthread_mutex_init(m, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+static inline void mtx_default_destroy(pthread_mutex_t *m) { pthread_mutex_destroy(m); }
+static inline void mtx_default_lock(pthread_mutex_t *m) { pthread_mutex_lock(m); }
+static inline int mtx_default_trylock(pthread_mutex_t *m) { return pthread_mutex_trylock(m); }
+static inline void mtx_default_unlock(pthread_mutex_t *m) { pthread_mutex_unlock(m); }
+static inline int mtx_default_timedlock(pthread_mutex_t *m, clockid_t c, const struct timespec *t) { return mtx_timedlock(m, c, t); }
+
+// PTHREAD_MUTEX_RECURSIVE
+static inline void mtx_recursive_init(pthread_mutex_t *m)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(m, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+static inline void mtx_recursive_destroy(pthread_mutex_t *m) { pthread_mutex_destroy(m); }
+static inline void mtx_recursive_lock(pthread_mutex_t *m) { pthread_mutex_lock(m); }
+static inline int mtx_recursive_trylock(pthread_mutex_t *m) { return pthread_mutex_trylock(m); }
+static inline void mtx_recursive_unlock(pthread_mutex_t *m) { pthread_mutex_unlock(m); }
+static inline int mtx_recursive_timedlock(pthread_mutex_t *m, clockid_t c, const struct timespec *t) { return mtx_timedlock(m, c, t); }
+
+// PTHREAD_MUTEX_ADAPTIVE_NP
+static inline void mtx_adaptive_init(pthread_mutex_t *m)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ADAPTIVE_NP);
+    pthread_mutex_init(m, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+static inline void mtx_adaptive_destroy(pthread_mutex_t *m) { pthread_mutex_destroy(m); }
+static inline void mtx_adaptive_lock(pthread_mutex_t *m) { pthread_mutex_lock(m); }
+static inline int mtx_adaptive_trylock(pthread_mutex_t *m) { return pthread_mutex_trylock(m); }
+static inline void mtx_adaptive_unlock(pthread_mutex_t *m) { pthread_mutex_unlock(m); }
+static inline int mtx_adaptive_timedlock(pthread_mutex_t *m, clockid_t c, const struct timespec *t) { return mtx_timedlock(m, c, t); }
+
+// PTHREAD_MUTEX_DEFAULT, PTHREAD_PROCESS_SHARED
+static inline void mtx_pshared_init(pthread_mutex_t *m)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_DEFAULT);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(m, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+static inline void mtx_pshared_destroy(pthread_mutex_t *m) { pthread_mutex_destroy(m); }
+static inline void mtx_pshared_lock(pthread_mutex_t *m) { pthread_mutex_lock(m); }
+static inline int mtx_pshared_trylock(pthread_mutex_t *m) { return pthread_mutex_trylock(m); }
+static inline void mtx_pshared_unlock(pthread_mutex_t *m) { pthread_mutex_unlock(m); }
+
+// The owner-caching recursive mutex is used as-is from owner_mutex.h.
+
+// TAS, TTAS and ticket spinlocks are used as-is from spinlock.h, and work
+// between processes as they are. MCS and CLH waiters spin on nodes in
+// their own memory, and FUTEX uses private futexes, so those do not.
+
+// MCS, spinning on a thread-local node
+static __thread struct mcs_node mcs_self;
+static inline void mcs_mutex_init(mcs_lock_t *l) { mcs_init(l); }
+static inline void mcs_mutex_destroy(mcs_lock_t *l) { mcs_destroy(l); }
+static inline void mcs_mutex_lock(mcs_lock_t *l) { mcs_lock(l, &mcs_self); }
+static inline int mcs_mutex_trylock(mcs_lock_t *l) { return mcs_trylock(l, &mcs_self); }
+static inline void mcs_mutex_unlock(mcs_lock_t *l) { mcs_unlock(l, &mcs_self); }
+
+// CLH, with a thread-local handle freed when the thread exits
+static pthread_key_t clh_self_key;
+static pthread_once_t clh_self_once = PTHREAD_ONCE_INIT;
+
+static void clh_self_free(void *me)
+{
+    clh_thread_destroy((struct clh_thread *)me);
+    free(me);
+}
+
+static void clh_self_key_init(void) { pthread_key_create(&clh_self_key, clh_self_free); }
+
+static inline struct clh_thread *clh_self(void)
+{
+    static __thread struct clh_thread *self = NULL;
+    if (self == NULL)
+    {
+        pthread_once(&clh_self_once, clh_self_key_init);
+        self = (struct clh_thread *)malloc(sizeof(struct clh_thread));
+        if (self == NULL || clh_thread_init(self) != 0)
+        {
+            dbprintlf(FATAL "Failed to allocate CLH node.");
+            exit(4);
+        }
+        pthread_setspecific(clh_self_key, self);
+    }
+    return self;
+}
+
+static inline void clh_mutex_init(clh_lock_t *l)
+{
+    if (clh_init(l) != 0)
+    {
+        dbprintlf(FATAL "Failed to allocate CLH node.");
+        exit(4);
+    }
+}
+static inline void clh_mutex_destroy(clh_lock_t *l) { clh_destroy(l); }
+static inline void clh_mutex_lock(clh_lock_t *l) { clh_lock(l, clh_self()); }
+static inline int clh_mutex_trylock(clh_lock_t *l) { return clh_trylock(l, clh_self()); }
+static inline void clh_mutex_unlock(clh_lock_t *l) { clh_unlock(l, clh_self()); }
+
+// pthread_rwlock_t, default kind (readers preferred in glibc)
+static inline void rw_default_init(pthread_rwlock_t *l) { pthread_rwlock_init(l, NULL); }
+static inline void rw_default_destroy(pthread_rwlock_t *l) { pthread_rwlock_destroy(l); }
+static inline void rw_default_rdlock(pthread_rwlock_t *l) { pthread_rwlock_rdlock(l); }
+static inline void rw_default_rdunlock(pthread_rwlock_t *l) { pthread_rwlock_unlock(l); }
+static inline void rw_default_wrlock(pthread_rwlock_t *l) { pthread_rwlock_wrlock(l); }
+static inline void rw_default_wrunlock(pthread_rwlock_t *l) { pthread_rwlock_unlock(l); }
+
+// PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP
+static inline void rw_writer_init(pthread_rwlock_t *l)
+{
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(l, &attr);
+    pthread_rwlockattr_destroy(&attr);
+}
+static inline void rw_writer_destroy(pthread_rwlock_t *l) { pthread_rwlock_destroy(l); }
+static inline void rw_writer_rdlock(pthread_rwlock_t *l) { pthread_rwlock_rdlock(l); }
+static inline void rw_writer_rdunlock(pthread_rwlock_t *l) { pthread_rwlock_unlock(l); }
+static inline void rw_writer_wrlock(pthread_rwlock_t *l) { pthread_rwlock_wrlock(l); }
+static inline void rw_writer_wrunlock(pthread_rwlock_t *l) { pthread_rwlock_unlock(l); }
+
+// The sequence lock is used as-is from seqlock.h.
+
+#ifdef __cplusplus
+
+#include <mutex>
+#include <shared_mutex>
+#include <chrono>
+
+/**
+ * @brief try_lock_until() on system_clock (CLOCK_REALTIME) or steady_clock
+ * (CLOCK_MONOTONIC), for the std timed mutexes.
+ */
+template <typename M>
+static inline int std_timedlock(M *m, clockid_t clock, const struct timespec *abs)
+{
+    auto d = std::chrono::seconds(abs->tv_sec) + std::chrono::nanoseconds(abs->tv_nsec);
+    bool ok;
+    if (clock == CLOCK_MONOTONIC)
+        ok = m->try_lock_until(std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(d)));
+    else
+        ok = m->try_lock_until(std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(d)));
+    return ok ? 0 : ETIMEDOUT;
+}
+
+// std::mutex
+static inline void std_mutex_init(std::mutex *) {}
+static inline void std_mutex_destroy(std::mutex *) {}
+static inline void std_mutex_lock(std::mutex *m) { m->lock(); }
+static inline int std_mutex_trylock(std::mutex *m) { return m->try_lock() ? 0 : EBUSY; }
+static inline void std_mutex_unlock(std::mutex *m) { m->unlock(); }
+
+// std::recursive_mutex
+static inline void std_recursive_mutex_init(std::recursive_mutex *) {}
+static inline void std_recursive_mutex_destroy(std::recursive_mutex *) {}
+static inline void std_recursive_mutex_lock(std::recursive_mutex *m) { m->lock(); }
+static inline int std_recursive_mutex_trylock(std::recursive_mutex *m) { return m->try_lock() ? 0 : EBUSY; }
+static inline void std_recursive_mutex_unlock(std::recursive_mutex *m) { m->unlock(); }
+
+// std::timed_mutex
+static inline void std_timed_mutex_init(std::timed_mutex *) {}
+static inline void std_timed_mutex_destroy(std::timed_mutex *) {}
+static inline void std_timed_mutex_lock(std::timed_mutex *m) { m->lock(); }
+static inline int std_timed_mutex_trylock(std::timed_mutex *m) { return m->try_lock() ? 0 : EBUSY; }
+static inline void std_timed_mutex_unlock(std::timed_mutex *m) { m->unlock(); }
+static inline int std_timed_mutex_timedlock(std::timed_mutex *m, clockid_t c, const struct timespec *t) { return std_timedlock(m, c, t); }
+
+// std::recursive_timed_mutex
+static inline void std_recursive_timed_mutex_init(std::recursive_timed_mutex *) {}
+static inline void std_recursive_timed_mutex_destroy(std::recursive_timed_mutex *) {}
+static inline void std_recursive_timed_mutex_lock(std::recursive_timed_mutex *m) { m->lock(); }
+static inline int std_recursive_timed_mutex_trylock(std::recursive_timed_mutex *m) { return m->try_lock() ? 0 : EBUSY; }
+static inline void std_recursive_timed_mutex_unlock(std::recursive_timed_mutex *m) { m->unlock(); }
+static inline int std_recursive_timed_mutex_timedlock(std::recursive_timed_mutex *m, clockid_t c, const struct timespec *t) { return std_timedlock(m, c, t); }
+
+// std::shared_mutex
+static inline void std_shared_mutex_init(std::shared_mutex *) {}
+static inline void std_shared_mutex_destroy(std::shared_mutex *) {}
+static inline void std_shared_mutex_rdlock(std::shared_mutex *m) { m->lock_shared(); }
+static inline void std_shared_mutex_rdunlock(std::shared_mutex *m) { m->unlock_shared(); }
+static inline void std_shared_mutex_wrlock(std::shared_mutex *m) { m->lock(); }
+static inline void std_shared_mutex_wrunlock(std::shared_mutex *m) { m->unlock(); }
+
+#endif // __cplusplus
+
+#endif // BENCH_LOCKS_H
@@ -0,0 +1,177 @@
+/**
+ * @file bench_mutex.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief pthread mutex type, protocol and robustness matrix.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * Instantiates bench_case.h for pthread_mutex_t as mtxm. Every mtxm lock
+ * is built from the attributes in mtxm_type / mtxm_protocol / mtxm_robust
+ * when it is initialized, so one instantiation covers every cell of the
+ * matrix and the lock path itself is the plain pthread_mutex_lock() call.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_MUTEX_H
+#define BENCH_MUTEX_H
+
+#include "bench.h"
+#include "bench_locks.h"
+#include <sched.h>
+
+#define MTXM_NTYPES 4
+#define MTXM_NPROTOCOLS 3
+#define MTXM_NROBUSTS 2
+
+static const int mtxm_types[MTXM_NTYPES] = {PTHREAD_MUTEX_NORMAL, PTHREAD_MUTEX_ERRORCHECK, PTHREAD_MUTEX_RECURSIVE, PTHREAD_MUTEX_ADAPTIVE_NP};
+static const char *mtxm_type_names[MTXM_NTYPES] = {"NORMAL", "ERRORCHECK", "RECURSIVE", "ADAPTIVE_NP"};
+static const int mtxm_protocols[MTXM_NPROTOCOLS] = {PTHREAD_PRIO_NONE, PTHREAD_PRIO_INHERIT, PTHREAD_PRIO_PROTECT};
+static const char *mtxm_protocol_names[MTXM_NPROTOCOLS] = {"PRIO_NONE", "PRIO_INHERIT", "PRIO_PROTECT"};
+static const int mtxm_robusts[MTXM_NROBUSTS] = {PTHREAD_MUTEX_STALLED, PTHREAD_MUTEX_ROBUST};
+static const char *mtxm_robust_names[MTXM_NROBUSTS] = {"STALLED", "ROBUST"};
+
+static int mtxm_type = PTHREAD_MUTEX_NORMAL;
+static int mtxm_protocol = PTHREAD_PRIO_NONE;
+static int mtxm_robust = PTHREAD_MUTEX_STALLED;
+
+/**
+ * @brief Initializes m with the current matrix cell's attributes.
+ *
+ * PRIO_PROTECT mutexes get the lowest SCHED_FIFO priority as their
+ * ceiling, which every SCHED_OTHER thread is allowed to lock under.
+ *
+ * @return 0, or the error from the first attribute or init call to fail.
+ */
+static inline int mtxm_init_attr(pthread_mutex_t *m)
+{
+    pthread_mutexattr_t attr;
+    int err = pthread_mutexattr_init(&attr);
+    if (err)
+        return err;
+    if ((err = pthread_mutexattr_settype(&attr, mtxm_type)) == 0 &&
+        (err = pthread_mutexattr_setprotocol(&attr, mtxm_protocol)) == 0 &&
+        (mtxm_protocol != PTHREAD_PRIO_PROTECT || (err = pthread_mutexattr_setprioceiling(&attr, sched_get_priority_min(SCHED_FIFO))) == 0) &&
+        (err = pthread_mutexattr_setrobust(&attr, mtxm_robust)) == 0)
+        err = pthread_mutex_init(m, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return err;
+}
+
+static inline void mtxm_init(pthread_mutex_t *m) { mtxm_init_attr(m); }
+static inline void mtxm_destroy(pthread_mutex_t *m) { pthread_mutex_destroy(m); }
+static inline void mtxm_lock(pthread_mutex_t *m) { pthread_mutex_lock(m); }
+static inline int mtxm_trylock(pthread_mutex_t *m) { return pthread_mutex_trylock(m); }
+static inline void mtxm_unlock(pthread_mutex_t *m) { pthread_mutex_unlock(m); }
+
+#define BENCH_LOCK mtxm
+#define BENCH_LOCK_T pthread_mutex_t
+#include "bench_case.h"
+
+/**
+ * @brief Checks that the current cell can be created, locked and unlocked
+ * here; PRIO_PROTECT needs the right to run at its ceiling, and some
+ * kernels or C libraries lack PI or robust futexes.
+ *
+ * @return 0, or the error of the step that failed, named in *step.
+ */
+static inline int mtxm_probe(const char **step)
+{
+    pthread_mutex_t m;
+    int err;
+    *step = "init";
+    if ((err = mtxm_init_attr(&m)) != 0)
+        return err;
+    *step = "lock";
+    if ((err = pthread_mutex_lock(&m)) == 0)
+    {
+        *step = "unlock";
+        err = pthread_mutex_unlock(&m);
+    }
+    pthread_mutex_destroy(&m);
+    return err;
+}
+
+/**
+ * @brief Runs the uncontended and contended cases for every combination of
+ * mutex type, protocol and robustness, skipping the cells this system
+ * refuses, then prints the matrix and writes it to the mutex results file.
+ *
+ * Cells are selected as kind "mutex" (bench_select.h), by the names
+ * "PTHREAD_MUTEX_<type>+<protocol>+<robust>" they are reported under.
+ */
+static inline void bench_mutex_matrix(void)
+{
+    double ul[MTXM_NTYPES][MTXM_NPROTOCOLS][MTXM_NROBUSTS];
+    struct bench_rate cl[MTXM_NTYPES][MTXM_NPROTOCOLS][MTXM_NROBUSTS];
+    int err[MTXM_NTYPES][MTXM_NPROTOCOLS][MTXM_NROBUSTS];
+    int ran[MTXM_NTYPES][MTXM_NPROTOCOLS][MTXM_NROBUSTS];
+    int nran = 0;
+    char name[64];
+
+    for (int t = 0; t < MTXM_NTYPES; t++)
+        for (int p = 0; p < MTXM_NPROTOCOLS; p++)
+            for (int r = 0; r < MTXM_NROBUSTS; r++)
+            {
+                const char *step;
+                mtxm_type = mtxm_types[t];
+                mtxm_protocol = mtxm_protocols[p];
+                mtxm_robust = mtxm_robusts[r];
+                snprintf(name, sizeof(name), "PTHREAD_MUTEX_%s+%s+%s", mtxm_type_names[t], mtxm_protocol_names[p], mtxm_robust_names[r]);
+                if (!(ran[t][p][r] = bench_selected("mutex", name)))
+                    continue;
+                nran++;
+                if ((err[t][p][r] = mtxm_probe(&step)) != 0)
+                {
+                    bprintlf(YELLOW_FG "[%s] Skipped, %s failed: %s", name, step, strerror(err[t][p][r]));
+                    continue;
+                }
+                // selected as a cell, so past the ul and cl filters
+                char label[256], desc[128] = "";
+                if (bench_wl.on)
+                    bench_wl_describe(desc, sizeof(desc));
+                snprintf(label, sizeof(label), bench_wl.on ? "%s %s" : "%s", name, desc);
+                bench_cfg.ul_quiet = 1; // written below, with the cell's name, to the mutex results
+                ul[t][p][r] = bench_solo_mtxm(name, &thread_fcn_ul_mtxm);
+                bench_cfg.ul_quiet = 0;
+                cl[t][p][r] = bench_contended(&bench_cl_n_mtxm, "cl", label, bench_cfg.cl_threads, bench_cfg.cl_trials);
+            }
+    mtxm_type = PTHREAD_MUTEX_NORMAL;
+    mtxm_protocol = PTHREAD_PRIO_NONE;
+    mtxm_robust = PTHREAD_MUTEX_STALLED;
+    if (nran == 0)
+        return;
+
+    bprintlf(GREEN_FG "Mutex matrix (ns per uncontended lock/unlock pair, contended acquisitions/s):");
+    for (int t = 0; t < MTXM_NTYPES; t++)
+        for (int p = 0; p < MTXM_NPROTOCOLS; p++)
+            for (int r = 0; r < MTXM_NROBUSTS; r++)
+            {
+                if (!ran[t][p][r])
+                    continue;
+                if (err[t][p][r])
+                {
+                    bprintlf(GREEN_FG "  %-11s %-12s %-7s  unsupported (%s)", mtxm_type_names[t], mtxm_protocol_names[p], mtxm_robust_names[r], strerror(err[t][p][r]));
+                    continue;
+                }
+                bprintlf(GREEN_FG "  %-11s %-12s %-7s  %8.2f ns  %14.0f /s", mtxm_type_names[t], mtxm_protocol_names[p], mtxm_robust_names[r], ul[t][p][r], cl[t][p][r].ops);
+                fprintf(bench_fopen(&bench_out.mutex, "mutex"), "%s, %s, %s, %.3f, %.0f, %.4f\n",
+                        mtxm_type_names[t], mtxm_protocol_names[p], mtxm_robust_names[r], ul[t][p][r], cl[t][p][r].ops, cl[t][p][r].cpu);
+            }
+}
+
+#endif // BENCH_MUTEX_H
@@ -0,0 +1,212 @@
+/**
+ * @file bench_perf.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Per-thread hardware and software event counters via perf_event_open(2).
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * bench_perf_probe() finds out once which events this process may count.
+ * Each worker then opens its own counters with bench_perf_open(), brackets
+ * its timed loop with bench_perf_start() and bench_perf_stop(), and closes
+ * them with bench_perf_close(). Until a probe succeeds every call is a
+ * no-op, so workers call them unconditionally.
+ *
+ * Counters are opened one by one rather than as a group, so an event the
+ * CPU or hypervisor lacks only drops that event. Counts are scaled by
+ * time enabled over time running in case the kernel multiplexed them.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_PERF_H
+#define BENCH_PERF_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+enum bench_perf_event
+{
+    BENCH_PERF_CYCLES,
+    BENCH_PERF_INSTRUCTIONS,
+    BENCH_PERF_L1D_MISSES,
+    BENCH_PERF_LLC_MISSES,
+    BENCH_PERF_BRANCH_MISSES,
+    BENCH_PERF_CTX_SWITCHES,
+    BENCH_PERF_NEVENTS,
+};
+
+static const char *const bench_perf_names[BENCH_PERF_NEVENTS] = {"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "ctx_switches"};
+
+/**
+ * @brief One thread's counters.
+ */
+struct bench_perf
+{
+    int fd[BENCH_PERF_NEVENTS];
+    uint32_t valid; // events counted in the last bench_perf_stop()
+    uint64_t count[BENCH_PERF_NEVENTS];
+};
+
+/**
+ * @brief What bench_perf_probe() found.
+ */
+static struct
+{
+    uint32_t avail;     // events that can be opened, 0 if counting is off
+    int exclude_kernel; // only user space may be counted
+} bench_perf_cfg;
+
+static inline int bench_perf_open_event(int ev, int exclude_kernel)
+{
+    struct perf_event_attr a;
+    memset(&a, 0, sizeof(a));
+    a.size = sizeof(a);
+    a.disabled = 1;
+    a.exclude_kernel = exclude_kernel;
+    a.exclude_hv = 1;
+    a.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    a.type = PERF_TYPE_HARDWARE;
+    switch (ev)
+    {
+    case BENCH_PERF_CYCLES:
+        a.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case BENCH_PERF_INSTRUCTIONS:
+        a.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case BENCH_PERF_L1D_MISSES:
+        a.type = PERF_TYPE_HW_CACHE;
+        a.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    case BENCH_PERF_LLC_MISSES:
+        a.type = PERF_TYPE_HW_CACHE;
+        a.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    case BENCH_PERF_BRANCH_MISSES:
+        a.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    default:
+        a.type = PERF_TYPE_SOFTWARE;
+        a.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+        break;
+    }
+    // this thread only, on any CPU
+    return (int)syscall(SYS_perf_event_open, &a, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+/**
+ * @brief Finds out which events can be counted and turns counting on for
+ * those. On failure, why says what is missing and why.
+ *
+ * @return The number of events that can be counted.
+ */
+static inline int bench_perf_probe(char *why, size_t len)
+{
+    int err = 0, n = 0;
+    why[0] = '\0';
+    memset(&bench_perf_cfg, 0, sizeof(bench_perf_cfg));
+    for (int pass = 0; pass < 2 && bench_perf_cfg.avail == 0; pass++)
+    {
+        bench_perf_cfg.exclude_kernel = pass;
+        for (int ev = 0; ev < BENCH_PERF_NEVENTS; ev++)
+        {
+            int fd = bench_perf_open_event(ev, pass);
+            if (fd < 0)
+            {
+                err = errno;
+                continue;
+            }
+            close(fd);
+            bench_perf_cfg.avail |= 1u << ev;
+        }
+        if (bench_perf_cfg.avail == 0 && err != EACCES && err != EPERM)
+            break; // not a permission problem, user space only will not help
+    }
+
+    size_t used = 0;
+    for (int ev = 0; ev < BENCH_PERF_NEVENTS; ev++)
+    {
+        if (bench_perf_cfg.avail & (1u << ev))
+            n++;
+        else if (used < len)
+            used += snprintf(why + used, len - used, "%s%s", used ? ", " : "", bench_perf_names[ev]);
+    }
+    if (n < BENCH_PERF_NEVENTS && used < len)
+        snprintf(why + used, len - used, " (%s)", strerror(err));
+    return n;
+}
+
+/**
+ * @brief Opens the calling thread's counters, disabled.
+ */
+static inline void bench_perf_open(struct bench_perf *p)
+{
+    p->valid = 0;
+    for (int ev = 0; ev < BENCH_PERF_NEVENTS; ev++)
+        p->fd[ev] = bench_perf_cfg.avail & (1u << ev) ? bench_perf_open_event(ev, bench_perf_cfg.exclude_kernel) : -1;
+}
+
+static inline void bench_perf_start(struct bench_perf *p)
+{
+    for (int ev = 0; ev < BENCH_PERF_NEVENTS; ev++)
+    {
+        if (p->fd[ev] < 0)
+            continue;
+        ioctl(p->fd[ev], PERF_EVENT_IOC_RESET, 0);
+        ioctl(p->fd[ev], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+/**
+ * @brief Stops the counters and reads them into p->count.
+ */
+static inline void bench_perf_stop(struct bench_perf *p)
+{
+    for (int ev = 0; ev < BENCH_PERF_NEVENTS; ev++)
+    {
+        if (p->fd[ev] >= 0)
+            ioctl(p->fd[ev], PERF_EVENT_IOC_DISABLE, 0);
+    }
+    p->valid = 0;
+    for (int ev = 0; ev < BENCH_PERF_NEVENTS; ev++)
+    {
+        uint64_t v[3]; // value, time enabled, time running
+        p->count[ev] = 0;
+        if (p->fd[ev] < 0 || read(p->fd[ev], v, sizeof(v)) != sizeof(v) || v[2] == 0)
+            continue;
+        p->count[ev] = v[2] < v[1] ? (uint64_t)((double)v[0] * v[1] / v[2]) : v[0];
+        p->valid |= 1u << ev;
+    }
+}
+
+static inline void bench_perf_close(struct bench_perf *p)
+{
+    for (int ev = 0; ev < BENCH_PERF_NEVENTS; ev++)
+    {
+        if (p->fd[ev] >= 0)
+            close(p->fd[ev]);
+        p->fd[ev] = -1;
+    }
+}
+
+#endif // BENCH_PERF_H
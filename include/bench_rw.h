@@ -0,0 +1,80 @@
+/**
+ * @file bench_rw.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Shared pieces of the reader-writer cases (see bench_rw_case.h).
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_RW_H
+#define BENCH_RW_H
+
+#include "bench.h"
+
+#ifndef BENCH_RW_WORDS
+#define BENCH_RW_WORDS 4 // 64-bit words in the protected value
+#endif
+
+/**
+ * @brief The value the reader-writer cases protect. Writers set every word
+ * to the same new value; a reader that sees two different words read it
+ * while a write was in progress.
+ */
+struct bench_rw_data
+{
+    uint64_t w[BENCH_RW_WORDS];
+};
+
+/**
+ * @brief Write ratios run by every reader-writer case, in writes per 1000.
+ */
+static const int bench_rw_ratios[] = {0, 10, 100, 500};
+
+static int bench_rw_permille = 0; // write ratio of the trials being run
+
+/**
+ * @brief Prints and records one reader-writer trial across n threads, and
+ * adds its throughput and CPU burn to acc.
+ */
+static inline void bench_report_rw(const char *name, struct bench_thread *thr, int n, struct bench_rate *acc)
+{
+    double reads = 0, writes = 0, cpu = 0, wall = 0;
+    uint64_t torn = 0;
+    for (int j = 0; j < n; j++)
+    {
+        double sec = timespec_sec(&thr[j].diff);
+        reads += (thr[j].count - thr[j].writes) / sec;
+        writes += thr[j].writes / sec;
+        cpu += timespec_sec(&thr[j].cpu);
+        torn += thr[j].torn;
+        if (sec > wall)
+            wall = sec;
+    }
+    cpu /= wall;
+    acc->ops += reads + writes;
+    acc->cpu += cpu;
+    bench_bin_trial(name, "rw", thr, n);
+
+    if (torn > 0)
+        dbprintlf(RED_FG "[%s] %" PRIu64 " reads saw a half-written value.", name, torn);
+    bprintlf(BLUE_FG "[%s] Threads: %d | Reads: %.0f /s | Writes: %.0f /s | CPU: %.2f cores", name, n, reads, writes, cpu);
+    fprintf(bench_fopen(&bench_out.rw, "rw"), "%s, %d, %.0f, %.0f, %.0f, %.3f\n", name, n, reads + writes, reads, writes, cpu);
+}
+
+#endif // BENCH_RW_H
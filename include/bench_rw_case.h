@@ -0,0 +1,222 @@
+/**
+ * @file bench_rw_case.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Reader-writer loops, specialized per lock type at compile time.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * Like bench_case.h, this header has no include guard: include it once per
+ * reader-writer lock after defining
+ *
+ *   BENCH_LOCK             name of the lock, e.g. rw_default
+ *   BENCH_LOCK_T           the lock's storage type, e.g. pthread_rwlock_t
+ *   BENCH_RW_OPTIMISTIC    (optional) readers validate instead of locking
+ *
+ * The lock must provide
+ *
+ *   void BENCH_LOCK_init(BENCH_LOCK_T *);
+ *   void BENCH_LOCK_destroy(BENCH_LOCK_T *);
+ *   void BENCH_LOCK_wrlock(BENCH_LOCK_T *);
+ *   void BENCH_LOCK_wrunlock(BENCH_LOCK_T *);
+ *
+ * and either, for locking readers,
+ *
+ *   void BENCH_LOCK_rdlock(BENCH_LOCK_T *);
+ *   void BENCH_LOCK_rdunlock(BENCH_LOCK_T *);
+ *
+ * or, with BENCH_RW_OPTIMISTIC, the sequence lock read side
+ *
+ *   unsigned BENCH_LOCK_read_begin(const BENCH_LOCK_T *);
+ *   int      BENCH_LOCK_read_retry(const BENCH_LOCK_T *, unsigned);  // nonzero: read again
+ *
+ * and gets, for example with BENCH_LOCK = rw_default,
+ *
+ *   void bench_rw_rw_default(const char *name);  // CASE SIX
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "bench_rw.h"
+
+#if !defined(BENCH_LOCK) || !defined(BENCH_LOCK_T)
+#error "Define BENCH_LOCK and BENCH_LOCK_T before including bench_rw_case.h"
+#endif
+
+#ifndef BENCH_CAT
+#define BENCH_CAT_(a, b) a##_##b
+#define BENCH_CAT(a, b) BENCH_CAT_(a, b)
+#endif // BENCH_CAT
+
+#define BENCH_FN(fn) BENCH_CAT(fn, BENCH_LOCK)
+#define BENCH_OP(op) BENCH_CAT(BENCH_LOCK, op)
+
+typedef struct
+{
+    BENCH_LOCK_T lock;
+    struct bench_rw_data data;
+} BENCH_FN(bench_rw_shared_t);
+
+static void *BENCH_FN(thread_fcn_rw)(void *_arg) // reader or writer, chosen per operation
+{
+    uint64_t count = 0, writes = 0, torn = 0;
+    struct timespec cpu_start, cpu_end;
+    struct bench_thread *arg = (struct bench_thread *)_arg;
+    BENCH_FN(bench_rw_shared_t) *shared = (BENCH_FN(bench_rw_shared_t) *)arg->lock;
+    BENCH_LOCK_T *lock = &shared->lock;
+    uint64_t *w = shared->data.w;
+    const int *done = arg->done;
+    uint64_t *counter = arg->counter;
+    const uint64_t permille = bench_rw_permille;
+    uint64_t rng = (uint64_t)(uintptr_t)arg | 1; // distinct, nonzero seed per thread
+    bench_perf_open(&arg->perf);
+    bench_start_line(arg);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+    uint64_t window = bench_window_start(&arg->start);
+    bench_perf_start(&arg->perf);
+    while (!bench_stopped(done)) // keep going until main stops you
+    {
+        if (bench_rng(&rng) % 1000 < permille)
+        {
+            BENCH_OP(wrlock)(lock);
+            uint64_t v = __atomic_load_n(&w[0], __ATOMIC_RELAXED) + 1;
+            for (int i = 0; i < BENCH_RW_WORDS; i++)
+                __atomic_store_n(&w[i], v, __ATOMIC_RELAXED);
+            BENCH_OP(wrunlock)(lock);
+            writes++;
+        }
+        else
+        {
+            uint64_t v[BENCH_RW_WORDS];
+#ifdef BENCH_RW_OPTIMISTIC
+            unsigned seq;
+            do
+            {
+                seq = BENCH_OP(read_begin)(lock);
+                for (int i = 0; i < BENCH_RW_WORDS; i++)
+                    v[i] = __atomic_load_n(&w[i], __ATOMIC_RELAXED);
+            } while (BENCH_OP(read_retry)(lock, seq));
+#else
+            BENCH_OP(rdlock)(lock);
+            for (int i = 0; i < BENCH_RW_WORDS; i++)
+                v[i] = __atomic_load_n(&w[i], __ATOMIC_RELAXED);
+            BENCH_OP(rdunlock)(lock);
+#endif // BENCH_RW_OPTIMISTIC
+            for (int i = 1; i < BENCH_RW_WORDS; i++)
+            {
+                if (v[i] != v[0])
+                {
+                    torn++;
+                    break;
+                }
+            }
+        }
+        __atomic_store_n(counter, ++count, __ATOMIC_RELAXED);
+    }
+    bench_perf_stop(&arg->perf);
+    bench_perf_close(&arg->perf);
+    bench_window_stop(window, &arg->diff);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+    timespec_diff(&cpu_start, &cpu_end, &arg->cpu);
+    arg->count = count;
+    arg->writes = writes;
+    arg->torn = torn;
+    return NULL;
+}
+
+/**
+ * @brief Runs one timed reader-writer trial on n workers sharing a fresh
+ * lock and value, pinned like bench_trial() in bench_case.h.
+ */
+static void BENCH_FN(bench_rw_trial)(struct bench_thread *thr, pthread_t *threads, int n, int layout)
+{
+    struct bench_layout lay;
+    bench_cfg.trial_layout = layout;
+    bench_layout_init(&lay, layout, sizeof(BENCH_FN(bench_rw_shared_t)), thr, n);
+    BENCH_FN(bench_rw_shared_t) *shared = BENCH_NEW(BENCH_FN(bench_rw_shared_t), lay.lock);
+    BENCH_OP(init)(&shared->lock);
+    bench_place_enter();
+    for (int j = 0; j < n; j++)
+    {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        bench_place_attr(&attr, j + 1);
+        pthread_create(&threads[j], &attr, &BENCH_FN(thread_fcn_rw), &thr[j]);
+        pthread_attr_destroy(&attr);
+    }
+    bench_wait_ready(&lay, n); // wait until every slave signals ready
+    bench_go(&lay);
+    bench_trial_sleep();
+    bench_stop(&lay); // trigger slave exit
+    for (int j = 0; j < n; j++)
+        pthread_join(threads[j], NULL);
+    bench_place_leave();
+    BENCH_OP(destroy)(&shared->lock);
+    BENCH_DELETE(BENCH_FN(bench_rw_shared_t), shared);
+    bench_layout_free(&lay);
+}
+
+static struct bench_rate BENCH_FN(bench_rw_n)(const char *name, struct bench_thread *thr, pthread_t *threads, int n, int trials, int layout)
+{
+    struct bench_rate acc = {0, 0};
+    struct bench_skew skew;
+    struct bench_adapt ad;
+    memset(&skew, 0, sizeof(skew));
+    bench_adapt_begin(&ad, trials);
+    while (bench_adapt_more(&ad))
+    {
+        BENCH_FN(bench_rw_trial)(thr, threads, n, layout);
+        if (bench_adapt_calibrate(&ad, thr, n))
+            continue;
+        bench_report_rw(name, thr, n, &acc);
+        bench_report_perf(name, "rw", thr, n);
+        bench_skew_add(&skew, thr, n);
+        bench_adapt_add(&ad, thr, n);
+    }
+    bench_adapt_end(&ad, name, "rw", n);
+
+    bench_report_skew(name, "rw", n, &skew);
+    acc.ops /= ad.trials;
+    acc.cpu /= ad.trials;
+    return acc;
+}
+
+/**
+ * @brief Reader-writer: threads read or write a multi-word value, at each
+ * write ratio in bench_rw_ratios. Runs are named "<name> <reads>/<writes>"
+ * in percent.
+ *
+ * Runs bench_cfg.cl_trials trials with bench_cfg.cl_threads threads, or at
+ * each count in bench_cfg.threads.
+ */
+BENCH_UNUSED static void BENCH_FN(bench_rw)(const char *name)
+{
+    if (!bench_selected("rw", name))
+        return;
+    for (size_t r = 0; r < sizeof(bench_rw_ratios) / sizeof(bench_rw_ratios[0]); r++)
+    {
+        char label[96];
+        bench_rw_permille = bench_rw_ratios[r];
+        snprintf(label, sizeof(label), "%s %g/%g", name, (1000 - bench_rw_permille) / 10.0, bench_rw_permille / 10.0);
+        bench_contended(&BENCH_FN(bench_rw_n), "rw", label, bench_cfg.cl_threads, bench_cfg.cl_trials);
+    }
+}
+
+#undef BENCH_FN
+#undef BENCH_OP
+#undef BENCH_LOCK
+#undef BENCH_LOCK_T
+#undef BENCH_RW_OPTIMISTIC
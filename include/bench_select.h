@@ -0,0 +1,217 @@
+/**
+ * @file bench_select.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Picks which cases run from the command line.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * Every generated case entry point (bench_rl_<lock>(), bench_cl_<lock>(),
+ * ...) asks bench_selected() whether to run before it does anything else,
+ * so the lock paths themselves stay specialized per lock at compile time.
+ * A filter is
+ *
+ *   KIND[:NAME]
+ *
+ * where KIND is one of bench_kinds and NAME the case name printed in the
+ * results, e.g. "cl:TICKET" or "mutex:*RECURSIVE+PRIO_INHERIT*". Both are
+ * fnmatch(3) patterns and NAME defaults to "*". A case runs when any
+ * filter matches it, or when there are none.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_SELECT_H
+#define BENCH_SELECT_H
+
+#include <ctype.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef BENCH_SEL_MAX
+#define BENCH_SEL_MAX 64 // filters
+#endif
+#ifndef BENCH_COUNTS_MAX
+#define BENCH_COUNTS_MAX 1024 // thread counts in a list
+#endif
+
+/**
+ * @brief Case kinds, as used in the result files.
+ */
+static const char *const bench_kinds[] = {"rl", "sl", "depth", "ul", "cl", "rw", "tl", "pp", "mutex", "xp", "atomic", "wake"};
+
+struct bench_filter
+{
+    char kind[16];
+    char name[112];
+};
+
+/**
+ * @brief The filters given on the command line.
+ */
+static struct
+{
+    int list; // print each selected case instead of running it
+    int n;
+    struct bench_filter f[BENCH_SEL_MAX];
+} bench_sel;
+
+/**
+ * @brief Adds the comma-separated filters in spec.
+ *
+ * @return 0, or -1 if a filter is malformed, too long, or its kind matches
+ * no kind in bench_kinds.
+ */
+static inline int bench_select_parse(const char *spec)
+{
+    char buf[1024];
+    if (strlen(spec) >= sizeof(buf))
+        return -1;
+    strcpy(buf, spec);
+    for (char *save = NULL, *tok = strtok_r(buf, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save))
+    {
+        if (bench_sel.n >= BENCH_SEL_MAX)
+            return -1;
+        struct bench_filter *f = &bench_sel.f[bench_sel.n];
+        char *colon = strchr(tok, ':');
+        const char *name = "*";
+        if (colon != NULL)
+        {
+            *colon = '\0';
+            name = colon + 1;
+        }
+        if (*tok == '\0' || strlen(tok) >= sizeof(f->kind) || strlen(name) >= sizeof(f->name))
+            return -1;
+        strcpy(f->kind, tok);
+        strcpy(f->name, *name != '\0' ? name : "*");
+
+        int known = 0;
+        for (size_t k = 0; k < sizeof(bench_kinds) / sizeof(bench_kinds[0]) && !known; k++)
+            known = fnmatch(f->kind, bench_kinds[k], 0) == 0;
+        if (!known)
+            return -1;
+        bench_sel.n++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Whether the case name of the given kind should run. In list mode,
+ * prints it as "kind:name" instead and returns 0.
+ */
+static inline int bench_selected(const char *kind, const char *name)
+{
+    int hit = bench_sel.n == 0;
+    for (int i = 0; i < bench_sel.n && !hit; i++)
+        hit = fnmatch(bench_sel.f[i].kind, kind, 0) == 0 && fnmatch(bench_sel.f[i].name, name, 0) == 0;
+    if (hit && bench_sel.list)
+    {
+        printf("%s:%s\n", kind, name);
+        return 0;
+    }
+    return hit;
+}
+
+/**
+ * @brief Parses all of s as a decimal integer. out is left alone on error.
+ *
+ * @return 0, or -1 if s is empty, has anything after the number or is out
+ * of range for a long.
+ */
+static inline int bench_long_parse(const char *s, long *out)
+{
+    char *end;
+    errno = 0;
+    long v = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || errno == ERANGE)
+        return -1;
+    *out = v;
+    return 0;
+}
+
+/**
+ * @brief Parses all of s as an unsigned decimal integer. Unlike strtoull(),
+ * a leading minus sign is an error, not a wrap-around.
+ */
+static inline int bench_u64_parse(const char *s, uint64_t *out)
+{
+    char *end;
+    if (!isdigit((unsigned char)*s))
+        return -1;
+    errno = 0;
+    unsigned long long v = strtoull(s, &end, 10);
+    if (*end != '\0' || errno == ERANGE)
+        return -1;
+    *out = v;
+    return 0;
+}
+
+/**
+ * @brief Parses all of s as a finite floating-point number.
+ */
+static inline int bench_double_parse(const char *s, double *out)
+{
+    char *end;
+    errno = 0;
+    double v = strtod(s, &end);
+    if (end == s || *end != '\0' || errno == ERANGE || !isfinite(v))
+        return -1;
+    *out = v;
+    return 0;
+}
+
+/**
+ * @brief Parses a list of positive counts such as "1,2,4,8" or "1-4,8".
+ *
+ * @return The number of counts stored in out, or -1 if the list is
+ * malformed or longer than max.
+ */
+static inline int bench_counts_parse(const char *s, int *out, int max)
+{
+    int n = 0;
+    while (*s != '\0')
+    {
+        char *end;
+        long lo = strtol(s, &end, 10), hi;
+        if (end == s || lo < 1)
+            return -1;
+        hi = lo;
+        if (*end == '-')
+        {
+            s = end + 1;
+            hi = strtol(s, &end, 10);
+            if (end == s || hi < lo)
+                return -1;
+        }
+        for (long c = lo; c <= hi; c++)
+        {
+            if (n >= max)
+                return -1;
+            out[n++] = (int)c;
+        }
+        if (*end != ',' && *end != '\0')
+            return -1;
+        s = *end == ',' ? end + 1 : end;
+    }
+    return n > 0 ? n : -1;
+}
+
+#endif // BENCH_SELECT_H
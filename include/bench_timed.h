@@ -0,0 +1,111 @@
+/**
+ * @file bench_timed.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Shared pieces of the timed-lock case (BENCH_LOCK_TIMED in bench_case.h).
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_TIMED_H
+#define BENCH_TIMED_H
+
+#include "bench.h"
+
+#ifndef TL_SAMPLES
+#define TL_SAMPLES 1000 // timed-out attempts per clock and timeout, at most
+#endif
+
+/**
+ * @brief Clocks the deadlines are given on.
+ */
+enum bench_timed_clock
+{
+    BENCH_TL_REALTIME,
+    BENCH_TL_MONOTONIC,
+    BENCH_TL_NCLOCKS,
+};
+
+static const clockid_t bench_tl_clocks[BENCH_TL_NCLOCKS] = {CLOCK_REALTIME, CLOCK_MONOTONIC};
+static const char *const bench_tl_clock_names[BENCH_TL_NCLOCKS] = {"REALTIME", "MONOTONIC"};
+
+/**
+ * @brief Timeouts the overshoot run waits for, in ns.
+ */
+static const uint64_t bench_tl_timeouts[] = {1000, 10000, 100000, 1000000, 10000000};
+
+/**
+ * @brief Attempts to make at timeout_ns: TL_SAMPLES, or fewer so that one
+ * timeout takes about bench_cfg.trig_timeout seconds.
+ */
+static inline uint64_t bench_tl_samples(uint64_t timeout_ns)
+{
+    uint64_t n = (uint64_t)(bench_cfg.trig_timeout * 1e9) / timeout_ns;
+    return n < TL_SAMPLES ? (n > 0 ? n : 1) : TL_SAMPLES;
+}
+
+static inline void timespec_add_ns(struct timespec *ts, uint64_t ns)
+{
+    ts->tv_sec += ns / 1000000000;
+    ts->tv_nsec += ns % 1000000000;
+    if (ts->tv_nsec >= 1000000000)
+    {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+/**
+ * @brief Prints and records the uncontended cost of lock/unlock and of
+ * timedlock/unlock on each clock, in ns per pair.
+ */
+static inline void bench_report_tl_cost(const char *name, double lock_ns, const double *timed_ns)
+{
+    bprintlf(BLUE_FG "[%s] Lock/Unlock: %.1f ns | Timedlock/Unlock: %.1f ns (%s), %.1f ns (%s)", name, lock_ns,
+             timed_ns[BENCH_TL_REALTIME], bench_tl_clock_names[BENCH_TL_REALTIME],
+             timed_ns[BENCH_TL_MONOTONIC], bench_tl_clock_names[BENCH_TL_MONOTONIC]);
+    fprintf(bench_fopen(&bench_out.tl, "tl"), "%s, %.2f, %.2f, %.2f\n", name, lock_ns, timed_ns[BENCH_TL_REALTIME], timed_ns[BENCH_TL_MONOTONIC]);
+}
+
+/**
+ * @brief Prints and records how far past their deadline timed-out attempts
+ * returned, given as a histogram in ns.
+ *
+ * @param early Attempts that returned ETIMEDOUT before the deadline.
+ * @param acquired Attempts that got the lock, which the main thread holds.
+ */
+static inline void bench_report_tl_overshoot(const char *name, int clock, uint64_t timeout_ns, const struct bench_hist *h, uint64_t early, uint64_t acquired)
+{
+    uint64_t p50 = bench_hist_quantile(h, 0.50);
+    uint64_t p99 = bench_hist_quantile(h, 0.99);
+    uint64_t p999 = bench_hist_quantile(h, 0.999);
+    uint64_t max = h->count ? h->max : 0;
+    char label[128], kind[16];
+    snprintf(label, sizeof(label), "%s %" PRIu64 "ns", name, timeout_ns);
+    snprintf(kind, sizeof(kind), "tl_%s", clock == BENCH_TL_REALTIME ? "realtime" : "monotonic");
+
+    if (early > 0 || acquired > 0)
+        dbprintlf(RED_FG "[%s] %s: %" PRIu64 " attempts returned early, %" PRIu64 " got a held lock.", label, bench_tl_clock_names[clock], early, acquired);
+    bprintlf(CYAN_FG "[%s] %s overshoot: n %" PRIu64 " | p50 %" PRIu64 " | p99 %" PRIu64 " | p99.9 %" PRIu64 " | max %" PRIu64 " ns",
+             label, bench_tl_clock_names[clock], h->count, p50, p99, p999, max);
+    fprintf(bench_fopen(&bench_out.tl_overshoot, "tl_overshoot"), "%s, %s, %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 "\n",
+            name, bench_tl_clock_names[clock], timeout_ns, h->count, p50, p99, p999, max, early, acquired);
+    bench_bin_buckets(label, kind, "ns", 1, h);
+}
+
+#endif // BENCH_TIMED_H
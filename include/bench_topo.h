@@ -0,0 +1,355 @@
+/**
+ * @file bench_topo.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief CPU topology discovery and thread placement profiles. Linux only.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * Reads /sys/devices/system/cpu to group the online CPUs by core, L3 and
+ * NUMA node, and builds one placement profile per relationship:
+ *
+ *   smt   hardware threads of the same core
+ *   l3    different cores sharing an L3
+ *   xl3   different L3s (CCX/CCD) on the same NUMA node
+ *   numa  different NUMA nodes
+ *
+ * A profile is an ordered CPU list; slot k of a trial (slot 0 is the main
+ * thread, slot j + 1 worker j) runs on cpus[k % ncpus]. Profiles the
+ * machine cannot provide are left out.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_TOPO_H
+#define BENCH_TOPO_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // cpu_set_t, pthread_attr_setaffinity_np
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <dirent.h>
+#include "meb_print.h"
+
+#ifndef BENCH_SYSFS_CPU
+#define BENCH_SYSFS_CPU "/sys/devices/system/cpu"
+#endif
+#ifndef BENCH_PLACE_CPUS
+#define BENCH_PLACE_CPUS 256 // most CPUs a single profile will use
+#endif
+
+enum bench_place_kind
+{
+    BENCH_PLACE_SMT,
+    BENCH_PLACE_L3,
+    BENCH_PLACE_XL3,
+    BENCH_PLACE_NUMA,
+    BENCH_NPLACES
+};
+
+static const char *const bench_place_names[BENCH_NPLACES] = {"smt", "l3", "xl3", "numa"};
+
+/**
+ * @brief An ordered list of CPUs to pin the threads of a trial to.
+ */
+struct bench_place
+{
+    int kind; // enum bench_place_kind
+    int ncpus;
+    int cpus[BENCH_PLACE_CPUS];
+};
+
+/**
+ * @brief Where one online CPU sits, as the lowest-numbered CPU of each domain.
+ */
+struct bench_cpu
+{
+    int cpu;
+    int core;
+    int l3;
+    int node;
+};
+
+/**
+ * @brief Reads the first line of a sysfs file, without the newline.
+ *
+ * @return 0 on success, -1 if the file could not be read.
+ */
+static inline int bench_sysfs_read(const char *path, char *buf, int size)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return -1;
+    char *ret = fgets(buf, size, fp);
+    fclose(fp);
+    if (ret == NULL)
+        return -1;
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+/**
+ * @brief Parses a sysfs CPU list such as "0-3,8,10-11".
+ *
+ * @return The lowest CPU in the list, or -1 if it is empty.
+ */
+static inline int bench_cpulist_parse(const char *s, cpu_set_t *set)
+{
+    int first = -1;
+    CPU_ZERO(set);
+    while (*s != '\0')
+    {
+        char *end;
+        long lo = strtol(s, &end, 10), hi;
+        if (end == s)
+            break;
+        hi = lo;
+        if (*end == '-')
+        {
+            s = end + 1;
+            hi = strtol(s, &end, 10);
+        }
+        for (long c = lo; c <= hi && c < CPU_SETSIZE; c++)
+            CPU_SET(c, set);
+        if (first < 0 || lo < first)
+            first = (int)lo;
+        s = *end == ',' ? end + 1 : end;
+    }
+    return first;
+}
+
+/**
+ * @brief Returns the lowest CPU of the sysfs CPU list at path, or fallback.
+ */
+static inline int bench_sysfs_first_cpu(const char *path, int fallback)
+{
+    char buf[4096];
+    cpu_set_t set;
+    if (bench_sysfs_read(path, buf, sizeof(buf)) != 0)
+        return fallback;
+    int first = bench_cpulist_parse(buf, &set);
+    return first < 0 ? fallback : first;
+}
+
+/**
+ * @brief Finds the core, L3 and NUMA node of a CPU.
+ *
+ * A CPU without an L3 in sysfs gets its package as its L3 domain, and one
+ * without a node link is put on node 0.
+ */
+static inline void bench_cpu_locate(int c, struct bench_cpu *out)
+{
+    char path[256], buf[64];
+    out->cpu = c;
+
+    snprintf(path, sizeof(path), BENCH_SYSFS_CPU "/cpu%d/topology/thread_siblings_list", c);
+    out->core = bench_sysfs_first_cpu(path, c);
+
+    snprintf(path, sizeof(path), BENCH_SYSFS_CPU "/cpu%d/topology/package_cpus_list", c);
+    out->l3 = bench_sysfs_first_cpu(path, -1);
+    if (out->l3 < 0)
+    {
+        snprintf(path, sizeof(path), BENCH_SYSFS_CPU "/cpu%d/topology/core_siblings_list", c);
+        out->l3 = bench_sysfs_first_cpu(path, 0);
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        snprintf(path, sizeof(path), BENCH_SYSFS_CPU "/cpu%d/cache/index%d/level", c, i);
+        if (bench_sysfs_read(path, buf, sizeof(buf)) != 0)
+            break;
+        if (atoi(buf) != 3)
+            continue;
+        snprintf(path, sizeof(path), BENCH_SYSFS_CPU "/cpu%d/cache/index%d/shared_cpu_list", c, i);
+        out->l3 = bench_sysfs_first_cpu(path, out->l3);
+        break;
+    }
+
+    out->node = 0;
+    snprintf(path, sizeof(path), BENCH_SYSFS_CPU "/cpu%d", c);
+    DIR *dir = opendir(path);
+    if (dir != NULL)
+    {
+        struct dirent *ent;
+        while ((ent = readdir(dir)) != NULL)
+        {
+            int node;
+            if (sscanf(ent->d_name, "node%d", &node) == 1)
+            {
+                out->node = node;
+                break;
+            }
+        }
+        closedir(dir);
+    }
+}
+
+/**
+ * @brief Adds cpu to the profile unless it is full.
+ */
+static inline void bench_place_add(struct bench_place *p, int cpu)
+{
+    if (p->ncpus < BENCH_PLACE_CPUS)
+        p->cpus[p->ncpus++] = cpu;
+}
+
+/**
+ * @brief The domain a profile of kind stays within: a core, an L3, a node
+ * or the whole machine.
+ */
+static inline int bench_place_scope(const struct bench_cpu *c, int kind)
+{
+    switch (kind)
+    {
+    case BENCH_PLACE_SMT:
+        return c->core;
+    case BENCH_PLACE_L3:
+        return c->l3;
+    case BENCH_PLACE_XL3:
+        return c->node;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief The domain a profile of kind spreads its threads over: hardware
+ * threads, cores, L3s or nodes.
+ */
+static inline int bench_place_unit(const struct bench_cpu *c, int kind)
+{
+    switch (kind)
+    {
+    case BENCH_PLACE_SMT:
+        return c->cpu;
+    case BENCH_PLACE_L3:
+        return c->core;
+    case BENCH_PLACE_XL3:
+        return c->l3;
+    default:
+        return c->node;
+    }
+}
+
+/**
+ * @brief Builds a profile of kind from the n CPUs in cpu.
+ *
+ * Picks the first scope (see bench_place_scope()) that holds at least two
+ * units (see bench_place_unit()), and takes the first CPU of each unit in
+ * it.
+ *
+ * @return 0 on success, -1 if the machine has no such pair of CPUs.
+ */
+static inline int bench_place_build(struct bench_place *p, int kind, const struct bench_cpu *cpu, int n)
+{
+    p->kind = kind;
+    for (int a = 0; a < n; a++)
+    {
+        int scope = bench_place_scope(&cpu[a], kind);
+        p->ncpus = 0;
+        for (int b = 0; b < n; b++)
+        {
+            int take = bench_place_scope(&cpu[b], kind) == scope;
+            for (int k = 0; k < b && take; k++)
+                take = bench_place_scope(&cpu[k], kind) != scope || bench_place_unit(&cpu[k], kind) != bench_place_unit(&cpu[b], kind);
+            if (take)
+                bench_place_add(p, cpu[b].cpu);
+        }
+        if (p->ncpus >= 2)
+            return 0;
+    }
+    p->ncpus = 0;
+    return -1;
+}
+
+/**
+ * @brief Discovers the topology and builds the profiles selected in mask
+ * (bit k for enum bench_place_kind k) that this machine can provide, using
+ * only the online CPUs in allowed (e.g. the process's cpuset).
+ *
+ * @return The number of profiles written to out.
+ */
+static inline int bench_topo_init(struct bench_place *out, unsigned mask, const cpu_set_t *allowed)
+{
+    char buf[4096];
+    cpu_set_t online;
+    if (bench_sysfs_read(BENCH_SYSFS_CPU "/online", buf, sizeof(buf)) != 0 || bench_cpulist_parse(buf, &online) < 0)
+    {
+        dbprintlf(RED_FG "Cannot read the CPU topology from " BENCH_SYSFS_CPU ".");
+        return 0;
+    }
+    CPU_AND(&online, &online, allowed);
+
+    int n = CPU_COUNT(&online);
+    struct bench_cpu *cpu = (struct bench_cpu *)calloc(n, sizeof(struct bench_cpu));
+    if (cpu == NULL)
+        return 0;
+    for (int c = 0, i = 0; c < CPU_SETSIZE && i < n; c++)
+    {
+        if (CPU_ISSET(c, &online))
+            bench_cpu_locate(c, &cpu[i++]);
+    }
+
+    int count = 0;
+    for (int kind = 0; kind < BENCH_NPLACES; kind++)
+    {
+        if (!(mask & (1u << kind)))
+            continue;
+        if (bench_place_build(&out[count], kind, cpu, n) == 0)
+            count++;
+        else
+            bprintlf(YELLOW_FG "Placement %s is not available on this machine, skipping it.", bench_place_names[kind]);
+    }
+    free(cpu);
+    return count;
+}
+
+/**
+ * @brief Parses a comma-separated list of profile names, e.g. "smt,numa".
+ *
+ * @return A mask of the profiles named, or 0 if any name is unknown.
+ */
+static inline unsigned bench_place_parse(const char *list)
+{
+    unsigned mask = 0;
+    while (*list != '\0')
+    {
+        size_t len = strcspn(list, ",");
+        int kind;
+        for (kind = 0; kind < BENCH_NPLACES; kind++)
+        {
+            if (strlen(bench_place_names[kind]) == len && strncmp(list, bench_place_names[kind], len) == 0)
+                break;
+        }
+        if (kind == BENCH_NPLACES)
+            return 0;
+        mask |= 1u << kind;
+        list += len;
+        if (*list == ',')
+            list++;
+    }
+    return mask;
+}
+
+static inline int bench_place_cpu(const struct bench_place *p, int slot)
+{
+    return p->cpus[slot % p->ncpus];
+}
+
+#endif // BENCH_TOPO_H
@@ -0,0 +1,473 @@
+/**
+ * @file bench_wake.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Wakeup primitives and the shared pieces of the wakeup case (see bench_wake_case.h).
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * A wakeup primitive is anything a thread can sleep in until another thread
+ * lets it go: a condition variable, a semaphore, a futex-backed atomic wait,
+ * a latch or a barrier. Each comes as a storage type and a set of
+ * operations, in the style of the lock adapters in bench_locks.h, with
+ * either or both of
+ *
+ *   tokens:     post(k) makes k tokens available, take() sleeps for one
+ *   generation: bcast() ends a generation, wait() sleeps until it ends
+ *
+ * The C++20 primitives are only built where the library has them
+ * (__cpp_lib_semaphore, __cpp_lib_atomic_wait, __cpp_lib_latch and
+ * __cpp_lib_barrier).
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_WAKE_H
+#define BENCH_WAKE_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <errno.h>
+#include "bench.h"
+#include "bench_handoff.h"
+
+#ifndef BENCH_WAKE_MAX
+#define BENCH_WAKE_MAX 256 // runs kept for bench_wake_summary()
+#endif
+
+/**
+ * @brief How the waker wakes the waiters each round: one token, one token
+ * per waiter, or one broadcast.
+ */
+enum bench_wake_kind
+{
+    BENCH_WAKE_ONE,
+    BENCH_WAKE_EACH,
+    BENCH_WAKE_ALL,
+    BENCH_WAKE_NKINDS,
+};
+
+static const char *const bench_wake_kind_names[BENCH_WAKE_NKINDS] = {"one", "each", "all"};
+
+static int bench_wake_kind = BENCH_WAKE_ONE; // wakeup of the trials being run
+static const char *bench_wake_name = "";     // primitive of the trials being run, without wakeup and mode
+
+/**
+ * @brief Trial state besides the primitive. The waker owns round, open,
+ * stamp and last; the waiters only read them.
+ */
+struct bench_wake_state
+{
+    unsigned waiters; // threads that sleep in the primitive
+    unsigned waiting; // waiters between announcing themselves and waking
+    unsigned acks;    // waiters woken in the current round
+    unsigned round;   // current round
+    unsigned open;    // last round whose waiters may go back to sleep
+    int last;         // set before the wakeup that ends the trial
+    uint64_t stamp;   // bench_ticks() right before the current round's wakeup
+} __attribute__((aligned(BENCH_CACHELINE)));
+
+static struct bench_wake_state bench_wk;
+
+/**
+ * @brief Waits until *v is want, yielding after PP_SPINS polls since the
+ * thread it waits for may need this CPU. Every round ends, so this does
+ * not look at the stop flag.
+ */
+static inline void bench_wake_until(const unsigned *v, unsigned want)
+{
+    for (int spins = 0; __atomic_load_n(v, __ATOMIC_ACQUIRE) != want; spins++)
+    {
+        if (spins < PP_SPINS)
+            cpu_relax();
+        else
+            sched_yield();
+    }
+}
+
+/**
+ * @brief A pthread condition variable guarding a token count and a
+ * generation number.
+ */
+struct bench_cond
+{
+    pthread_mutex_t m;
+    pthread_cond_t c;
+    int tokens;
+    uint64_t gen;
+};
+
+static inline void cond_var_init(struct bench_cond *w, int waiters)
+{
+    (void)waiters;
+    pthread_mutex_init(&w->m, NULL);
+    pthread_cond_init(&w->c, NULL);
+    w->tokens = 0;
+    w->gen = 0;
+}
+
+static inline void cond_var_destroy(struct bench_cond *w)
+{
+    pthread_cond_destroy(&w->c);
+    pthread_mutex_destroy(&w->m);
+}
+
+static inline void cond_var_post(struct bench_cond *w, int k) // one pthread_cond_signal() per token
+{
+    pthread_mutex_lock(&w->m);
+    w->tokens += k;
+    for (int i = 0; i < k; i++)
+        pthread_cond_signal(&w->c);
+    pthread_mutex_unlock(&w->m);
+}
+
+static inline void cond_var_take(struct bench_cond *w)
+{
+    pthread_mutex_lock(&w->m);
+    while (w->tokens == 0)
+        pthread_cond_wait(&w->c, &w->m);
+    w->tokens--;
+    pthread_mutex_unlock(&w->m);
+}
+
+static inline void cond_var_bcast(struct bench_cond *w)
+{
+    pthread_mutex_lock(&w->m);
+    w->gen++;
+    pthread_cond_broadcast(&w->c);
+    pthread_mutex_unlock(&w->m);
+}
+
+static inline void cond_var_wait(struct bench_cond *w, uint64_t *seen)
+{
+    pthread_mutex_lock(&w->m);
+    while (w->gen == *seen)
+        pthread_cond_wait(&w->c, &w->m);
+    *seen = w->gen;
+    pthread_mutex_unlock(&w->m);
+}
+
+static inline void cond_var_rearm(struct bench_cond *w) { (void)w; }
+
+static inline void posix_sem_init(sem_t *w, int waiters)
+{
+    (void)waiters;
+    sem_init(w, 0, 0);
+}
+
+static inline void posix_sem_destroy(sem_t *w) { sem_destroy(w); }
+
+static inline void posix_sem_post(sem_t *w, int k)
+{
+    for (int i = 0; i < k; i++)
+        sem_post(w);
+}
+
+static inline void posix_sem_take(sem_t *w)
+{
+    while (sem_wait(w) != 0 && errno == EINTR)
+        ;
+}
+
+#ifdef __cplusplus
+
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#if __cplusplus >= 202002L
+#include <version>
+#endif
+
+/**
+ * @brief std::condition_variable guarding a token count and a generation
+ * number, as struct bench_cond.
+ */
+struct bench_std_cv
+{
+    std::mutex m;
+    std::condition_variable c;
+    int tokens = 0;
+    uint64_t gen = 0;
+};
+
+static inline void std_cv_init(struct bench_std_cv *, int) {}
+static inline void std_cv_destroy(struct bench_std_cv *) {}
+
+static inline void std_cv_post(struct bench_std_cv *w, int k)
+{
+    std::lock_guard<std::mutex> g(w->m);
+    w->tokens += k;
+    for (int i = 0; i < k; i++)
+        w->c.notify_one();
+}
+
+static inline void std_cv_take(struct bench_std_cv *w)
+{
+    std::unique_lock<std::mutex> g(w->m);
+    w->c.wait(g, [w] { return w->tokens > 0; });
+    w->tokens--;
+}
+
+static inline void std_cv_bcast(struct bench_std_cv *w)
+{
+    std::lock_guard<std::mutex> g(w->m);
+    w->gen++;
+    w->c.notify_all();
+}
+
+static inline void std_cv_wait(struct bench_std_cv *w, uint64_t *seen)
+{
+    std::unique_lock<std::mutex> g(w->m);
+    w->c.wait(g, [w, seen] { return w->gen != *seen; });
+    *seen = w->gen;
+}
+
+static inline void std_cv_rearm(struct bench_std_cv *) {}
+
+#ifdef __cpp_lib_semaphore
+#include <semaphore>
+
+struct bench_std_sem
+{
+    std::counting_semaphore<> s{0};
+};
+
+static inline void std_sem_init(struct bench_std_sem *, int) {}
+static inline void std_sem_destroy(struct bench_std_sem *) {}
+static inline void std_sem_post(struct bench_std_sem *w, int k) { w->s.release(k); }
+static inline void std_sem_take(struct bench_std_sem *w) { w->s.acquire(); }
+#endif // __cpp_lib_semaphore
+
+#ifdef __cpp_lib_atomic_wait
+/**
+ * @brief std::atomic::wait() and notify_one()/notify_all() on a token count
+ * and a generation number, with no mutex.
+ */
+struct bench_std_wait
+{
+    std::atomic<uint32_t> tokens{0};
+    std::atomic<uint32_t> gen{0};
+};
+
+static inline void std_wait_init(struct bench_std_wait *, int) {}
+static inline void std_wait_destroy(struct bench_std_wait *) {}
+
+static inline void std_wait_post(struct bench_std_wait *w, int k)
+{
+    w->tokens.fetch_add(k, std::memory_order_release);
+    for (int i = 0; i < k; i++)
+        w->tokens.notify_one();
+}
+
+static inline void std_wait_take(struct bench_std_wait *w)
+{
+    uint32_t t = w->tokens.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        if (t == 0)
+        {
+            w->tokens.wait(0, std::memory_order_relaxed);
+            t = w->tokens.load(std::memory_order_relaxed);
+        }
+        else if (w->tokens.compare_exchange_weak(t, t - 1, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+}
+
+static inline void std_wait_bcast(struct bench_std_wait *w)
+{
+    w->gen.fetch_add(1, std::memory_order_release);
+    w->gen.notify_all();
+}
+
+static inline void std_wait_wait(struct bench_std_wait *w, uint64_t *seen)
+{
+    uint32_t g;
+    while ((g = w->gen.load(std::memory_order_acquire)) == (uint32_t)*seen)
+        w->gen.wait(g, std::memory_order_acquire);
+    *seen = g;
+}
+
+static inline void std_wait_rearm(struct bench_std_wait *) {}
+#endif // __cpp_lib_atomic_wait
+
+#ifdef __cpp_lib_latch
+#include <latch>
+#include <new>
+
+/**
+ * @brief A std::latch of 1. A latch cannot be reused, so each round gets
+ * a new one.
+ */
+struct bench_std_latch
+{
+    std::latch l{1};
+};
+
+static inline void std_latch_init(struct bench_std_latch *, int) {}
+static inline void std_latch_destroy(struct bench_std_latch *) {}
+static inline void std_latch_bcast(struct bench_std_latch *w) { w->l.count_down(); }
+static inline void std_latch_wait(struct bench_std_latch *w, uint64_t *) { w->l.wait(); }
+
+static inline void std_latch_rearm(struct bench_std_latch *w)
+{
+    w->l.~latch();
+    new (&w->l) std::latch(1);
+}
+#endif // __cpp_lib_latch
+
+#ifdef __cpp_lib_barrier
+#include <barrier>
+
+/**
+ * @brief A std::barrier of the waiters and the waker. The waker arrives
+ * without waiting, which completes the phase.
+ */
+struct bench_std_barrier
+{
+    std::barrier<> *b = nullptr;
+};
+
+static inline void std_barrier_init(struct bench_std_barrier *w, int waiters) { w->b = new std::barrier<>(waiters + 1); }
+static inline void std_barrier_destroy(struct bench_std_barrier *w) { delete w->b; }
+
+static inline void std_barrier_bcast(struct bench_std_barrier *w)
+{
+    auto token = w->b->arrive();
+    (void)token;
+}
+
+static inline void std_barrier_wait(struct bench_std_barrier *w, uint64_t *) { w->b->arrive_and_wait(); }
+static inline void std_barrier_rearm(struct bench_std_barrier *) {}
+#endif // __cpp_lib_barrier
+
+#endif // __cplusplus
+
+/**
+ * @brief A run of the wakeup case, kept for bench_wake_summary().
+ */
+struct bench_wake_run
+{
+    char name[96]; // primitive and placement profile
+    int kind;
+    int mode;
+    int waiters;
+    double rate;
+    uint64_t p50;
+    uint64_t p99;
+};
+
+static struct bench_wake_run bench_wake_runs[BENCH_WAKE_MAX];
+static int bench_wake_nruns = 0;
+
+/**
+ * @brief Prints and records the wakeup latency of a run of trials at n
+ * threads, the waker being thr[0], from the waiters' histograms in
+ * hist[BENCH_OP_LOCK], and resets them.
+ *
+ * @return Wakeups per second, averaged over the trials.
+ */
+static inline double bench_report_wake(const char *name, struct bench_thread *thr, int n, int trials)
+{
+    struct bench_hist *total = bench_hist_alloc(1);
+    if (total == NULL)
+        return 0;
+    double wall = 0;
+    for (int j = 0; j < n; j++)
+    {
+        if (j > 0)
+        {
+            bench_hist_merge(total, &thr[j].hist[BENCH_OP_LOCK]);
+            bench_hist_reset(&thr[j].hist[BENCH_OP_LOCK]);
+        }
+        double sec = timespec_sec(&thr[j].diff);
+        if (sec > wall)
+            wall = sec;
+    }
+    double rate = total->count / (wall * trials);
+    uint64_t p50 = bench_hist_quantile(total, 0.50);
+    uint64_t p99 = bench_hist_quantile(total, 0.99);
+    uint64_t p999 = bench_hist_quantile(total, 0.999);
+    uint64_t max = total->count ? total->max : 0;
+    const char *kind = bench_wake_kind_names[bench_wake_kind], *mode = bench_pp_mode_names[bench_pp_mode];
+    char bin_kind[16];
+    snprintf(bin_kind, sizeof(bin_kind), "wake_%s_%s", kind, mode);
+
+    bprintlf(CYAN_FG "[%s] Waiters: %d | Wakeups: %.0f /s | Post to wake: p50 %" PRIu64 " | p99 %" PRIu64 " | p99.9 %" PRIu64 " | max %" PRIu64 " ns",
+             name, n - 1, rate, p50, p99, p999, max);
+    fprintf(bench_fopen(&bench_out.wake, "wake"), "%s, %s, %s, %d, %.0f, %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 "\n",
+            name, kind, mode, n - 1, rate, p50, p99, p999, max);
+    bench_bin_buckets(name, bin_kind, "ns", n - 1, total);
+    free(total);
+
+    if (bench_wake_nruns < BENCH_WAKE_MAX)
+    {
+        struct bench_wake_run *r = &bench_wake_runs[bench_wake_nruns++];
+        if (bench_cfg.place >= 0)
+            snprintf(r->name, sizeof(r->name), "%s @%s", bench_wake_name, bench_place_names[bench_cfg.places[bench_cfg.place].kind]);
+        else
+            snprintf(r->name, sizeof(r->name), "%s", bench_wake_name);
+        r->kind = bench_wake_kind;
+        r->mode = bench_pp_mode;
+        r->waiters = n - 1;
+        r->rate = rate;
+        r->p50 = p50;
+        r->p99 = p99;
+    }
+    return rate;
+}
+
+/**
+ * @brief Prints every run recorded by bench_report_wake() so far, grouped
+ * by wakeup and mode, marking the lowest median latency and the highest
+ * rate at each waiter count, and forgets them.
+ */
+static inline void bench_wake_summary(void)
+{
+    if (bench_wake_nruns == 0)
+        return;
+    bprintlf(GREEN_FG "Wakeups (rate, post to wake p50 / p99; * lowest p50, + highest rate at that wakeup, mode and waiter count):");
+    for (int kind = 0; kind < BENCH_WAKE_NKINDS; kind++)
+    {
+        for (int mode = 0; mode < BENCH_PP_NMODES; mode++)
+        {
+            for (int i = 0; i < bench_wake_nruns; i++)
+            {
+                const struct bench_wake_run *r = &bench_wake_runs[i];
+                if (r->kind != kind || r->mode != mode)
+                    continue;
+                int fastest = 1, busiest = 1;
+                for (int k = 0; k < bench_wake_nruns; k++)
+                {
+                    const struct bench_wake_run *o = &bench_wake_runs[k];
+                    if (o->kind != kind || o->mode != mode || o->waiters != r->waiters)
+                        continue;
+                    if (o->p50 < r->p50)
+                        fastest = 0;
+                    if (o->rate > r->rate)
+                        busiest = 0;
+                }
+                bprintlf(GREEN_FG "  %-4s %-4s %-48s x%-3d %12.0f /s  %8" PRIu64 " / %8" PRIu64 " ns %s%s", bench_wake_kind_names[kind], bench_pp_mode_names[mode],
+                         r->name, r->waiters, r->rate, r->p50, r->p99, fastest ? "*" : "", busiest ? "+" : "");
+            }
+        }
+    }
+    bench_wake_nruns = 0;
+}
+
+#endif // BENCH_WAKE_H
@@ -0,0 +1,280 @@
+/**
+ * @file bench_wake_case.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Wakeup loops, specialized per wakeup primitive at compile time.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * Like bench_case.h, this header has no include guard: include it once per
+ * wakeup primitive (see bench_wake.h) after defining
+ *
+ *   BENCH_LOCK          name of the primitive, e.g. cond_var
+ *   BENCH_LOCK_T        its storage type, e.g. struct bench_cond
+ *   BENCH_WAKE_TOKENS   (optional) primitive hands out tokens
+ *   BENCH_WAKE_BCAST    (optional) primitive wakes every waiter at once
+ *
+ * and at least one of the last two. The primitive must provide
+ *
+ *   void BENCH_LOCK_init(BENCH_LOCK_T *, int waiters);
+ *   void BENCH_LOCK_destroy(BENCH_LOCK_T *);
+ *
+ * and, with BENCH_WAKE_TOKENS,
+ *
+ *   void BENCH_LOCK_post(BENCH_LOCK_T *, int k);  // k more tokens, waking up to k waiters
+ *   void BENCH_LOCK_take(BENCH_LOCK_T *);         // sleeps until it gets a token
+ *
+ * and, with BENCH_WAKE_BCAST,
+ *
+ *   void BENCH_LOCK_bcast(BENCH_LOCK_T *);             // ends the generation
+ *   void BENCH_LOCK_wait(BENCH_LOCK_T *, uint64_t *);  // sleeps until the generation after *seen
+ *   void BENCH_LOCK_rearm(BENCH_LOCK_T *);             // between rounds, nobody waiting
+ *
+ * and gets, for example with BENCH_LOCK = cond_var,
+ *
+ *   void bench_wake_cond_var(const char *name);  // CASE TWELVE
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "bench_wake.h"
+
+#if !defined(BENCH_LOCK) || !defined(BENCH_LOCK_T)
+#error "Define BENCH_LOCK and BENCH_LOCK_T before including bench_wake_case.h"
+#endif
+#if !defined(BENCH_WAKE_TOKENS) && !defined(BENCH_WAKE_BCAST)
+#error "Define BENCH_WAKE_TOKENS, BENCH_WAKE_BCAST or both before including bench_wake_case.h"
+#endif
+
+#ifndef BENCH_CAT
+#define BENCH_CAT_(a, b) a##_##b
+#define BENCH_CAT(a, b) BENCH_CAT_(a, b)
+#endif // BENCH_CAT
+
+#define BENCH_FN(fn) BENCH_CAT(fn, BENCH_LOCK)
+#define BENCH_OP(op) BENCH_CAT(BENCH_LOCK, op)
+
+/**
+ * @brief Wakes the waiters the way kind says: a token, a token per waiter,
+ * or a broadcast.
+ */
+static inline void BENCH_FN(bench_wake_post)(BENCH_LOCK_T *w, int kind, int waiters)
+{
+    (void)kind;
+    (void)waiters;
+#ifdef BENCH_WAKE_BCAST
+    if (kind == BENCH_WAKE_ALL)
+    {
+        BENCH_OP(bcast)(w);
+        return;
+    }
+#endif
+#ifdef BENCH_WAKE_TOKENS
+    BENCH_OP(post)(w, kind == BENCH_WAKE_ONE ? 1 : waiters);
+#endif
+}
+
+static inline void BENCH_FN(bench_wake_sleep)(BENCH_LOCK_T *w, int kind, uint64_t *seen)
+{
+    (void)kind;
+    (void)seen;
+#ifdef BENCH_WAKE_BCAST
+    if (kind == BENCH_WAKE_ALL)
+    {
+        BENCH_OP(wait)(w, seen);
+        return;
+    }
+#endif
+#ifdef BENCH_WAKE_TOKENS
+    BENCH_OP(take)(w);
+#endif
+}
+
+static void *BENCH_FN(thread_fcn_waker)(void *_arg) // wakes the waiters once all of them are about to sleep
+{
+    uint64_t count = 0;
+    struct bench_thread *arg = (struct bench_thread *)_arg;
+    BENCH_LOCK_T *w = (BENCH_LOCK_T *)arg->lock;
+    const int *done = arg->done;
+    uint64_t *counter = arg->counter;
+    int kind = bench_wake_kind;
+    unsigned waiters = bench_wk.waiters, round = 0;
+    unsigned want = kind == BENCH_WAKE_ONE ? 1 : waiters;
+    bench_perf_open(&arg->perf);
+    bench_start_line(arg);
+    uint64_t window = bench_window_start(&arg->start);
+    bench_perf_start(&arg->perf);
+    for (;;)
+    {
+        bench_wake_until(&bench_wk.waiting, waiters);
+        bench_pp_park();
+        if (bench_stopped(done))
+            break;
+        __atomic_store_n(&bench_wk.acks, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&bench_wk.round, ++round, __ATOMIC_RELAXED);
+        bench_wk.stamp = bench_ticks();
+        BENCH_FN(bench_wake_post)(w, kind, waiters);
+        bench_wake_until(&bench_wk.acks, want);
+#ifdef BENCH_WAKE_BCAST
+        if (kind == BENCH_WAKE_ALL)
+            BENCH_OP(rearm)(w);
+#endif
+        __atomic_store_n(counter, ++count, __ATOMIC_RELAXED);
+        __atomic_store_n(&bench_wk.open, round, __ATOMIC_RELEASE);
+    }
+    // every waiter is asleep: wake them all for the last time
+    __atomic_store_n(&bench_wk.last, 1, __ATOMIC_RELAXED);
+    BENCH_FN(bench_wake_post)(w, kind == BENCH_WAKE_ALL ? BENCH_WAKE_ALL : BENCH_WAKE_EACH, waiters);
+    bench_perf_stop(&arg->perf);
+    bench_perf_close(&arg->perf);
+    bench_window_stop(window, &arg->diff);
+    arg->count = count;
+    return NULL;
+}
+
+static void *BENCH_FN(thread_fcn_waiter)(void *_arg) // sleeps in the primitive until the waker wakes it
+{
+    uint64_t count = 0, seen = 0;
+    struct bench_thread *arg = (struct bench_thread *)_arg;
+    BENCH_LOCK_T *w = (BENCH_LOCK_T *)arg->lock;
+    uint64_t *counter = arg->counter;
+    struct bench_hist *h = &arg->hist[BENCH_OP_LOCK];
+    int kind = bench_wake_kind;
+    bench_perf_open(&arg->perf);
+    bench_start_line(arg);
+    uint64_t window = bench_window_start(&arg->start);
+    bench_perf_start(&arg->perf);
+    for (;;) // only the waker's last wakeup ends the loop, so it never waits on a waiter that left
+    {
+        __atomic_add_fetch(&bench_wk.waiting, 1, __ATOMIC_RELEASE);
+        BENCH_FN(bench_wake_sleep)(w, kind, &seen);
+        uint64_t now = bench_ticks();
+        __atomic_sub_fetch(&bench_wk.waiting, 1, __ATOMIC_RELAXED);
+        if (__atomic_load_n(&bench_wk.last, __ATOMIC_RELAXED))
+            break;
+        bench_hist_record(h, bench_ns_between(bench_wk.stamp, now));
+        __atomic_store_n(counter, ++count, __ATOMIC_RELAXED);
+        unsigned round = __atomic_load_n(&bench_wk.round, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&bench_wk.acks, 1, __ATOMIC_RELEASE);
+        bench_wake_until(&bench_wk.open, round); // no second token in the same round
+    }
+    bench_perf_stop(&arg->perf);
+    bench_perf_close(&arg->perf);
+    bench_window_stop(window, &arg->diff);
+    arg->count = count;
+    return NULL;
+}
+
+/**
+ * @brief Runs one timed trial with thr[0] as the waker and the other n - 1
+ * workers as waiters on a fresh primitive.
+ */
+static void BENCH_FN(bench_wake_trial)(struct bench_thread *thr, pthread_t *threads, int n, int layout)
+{
+    struct bench_layout lay;
+    bench_cfg.trial_layout = layout;
+    bench_layout_init(&lay, layout, sizeof(BENCH_LOCK_T), thr, n);
+    BENCH_LOCK_T *w = BENCH_NEW(BENCH_LOCK_T, lay.lock);
+    BENCH_OP(init)(w, n - 1);
+    memset(&bench_wk, 0, sizeof(bench_wk));
+    bench_wk.waiters = n - 1;
+    bench_place_enter();
+    bench_spawn(&lay, &BENCH_FN(thread_fcn_waker), thr, threads, 0);
+    for (int j = 1; j < n; j++)
+        bench_spawn(&lay, &BENCH_FN(thread_fcn_waiter), thr, threads, j);
+    bench_wait_ready(&lay, n);
+    bench_go(&lay);
+    bench_trial_sleep();
+    bench_stop(&lay);
+    for (int j = 0; j < n; j++)
+        bench_join(&lay, thr, threads, j);
+    bench_place_leave();
+    BENCH_OP(destroy)(w);
+    BENCH_DELETE(BENCH_LOCK_T, w);
+    bench_layout_free(&lay);
+}
+
+static struct bench_rate BENCH_FN(bench_wake_n)(const char *name, struct bench_thread *thr, pthread_t *threads, int n, int trials, int layout)
+{
+    struct bench_rate acc = {0, 0};
+    if (n < 2) // nobody to wake
+        return acc;
+    int own_hist = thr[0].hist == NULL;
+    if (own_hist)
+        bench_hist_attach(thr, n);
+    struct bench_adapt ad;
+    bench_adapt_begin(&ad, trials);
+    while (bench_adapt_more(&ad))
+    {
+        BENCH_FN(bench_wake_trial)(thr, threads, n, layout);
+        if (bench_adapt_calibrate(&ad, thr + 1, n - 1)) // rates are the waiters' wakeups
+            continue;
+        bench_report_perf(name, "wake", thr, n);
+        bench_adapt_add(&ad, thr + 1, n - 1);
+    }
+    bench_adapt_end(&ad, name, "wake", n - 1);
+    acc.ops = bench_report_wake(name, thr, n, ad.trials);
+    if (own_hist)
+        bench_hist_detach(thr);
+    return acc;
+}
+
+/**
+ * @brief Wakeup: a waker thread waits until every waiter has announced it
+ * is about to sleep in the primitive, then wakes one of them, each of them
+ * with a token apiece, or all of them with one broadcast, and times each
+ * wakeup from just before the post. Runs once with the waiters likely
+ * still spinning and once with them likely asleep (see bench_handoff.h).
+ * Runs are named "<name> <one|each|all> <spin|park>".
+ *
+ * Runs bench_cfg.cl_trials trials with bench_cfg.cl_threads waiters, or at
+ * each count of 2 or more in bench_cfg.threads, the waker included.
+ */
+BENCH_UNUSED static void BENCH_FN(bench_wake)(const char *name)
+{
+    if (!bench_selected("wake", name))
+        return;
+    bench_wake_name = name;
+    for (int kind = 0; kind < BENCH_WAKE_NKINDS; kind++)
+    {
+#ifndef BENCH_WAKE_TOKENS
+        if (kind != BENCH_WAKE_ALL)
+            continue;
+#endif
+#ifndef BENCH_WAKE_BCAST
+        if (kind == BENCH_WAKE_ALL)
+            continue;
+#endif
+        for (int mode = 0; mode < BENCH_PP_NMODES; mode++)
+        {
+            char label[96];
+            bench_wake_kind = kind;
+            bench_pp_mode = mode;
+            snprintf(label, sizeof(label), "%s %s %s", name, bench_wake_kind_names[kind], bench_pp_mode_names[mode]);
+            bench_contended(&BENCH_FN(bench_wake_n), "wake", label, bench_cfg.cl_threads + 1, bench_cfg.cl_trials);
+        }
+    }
+    bench_wake_kind = BENCH_WAKE_ONE;
+    bench_pp_mode = BENCH_PP_SPIN;
+    bench_wake_name = "";
+}
+
+#undef BENCH_FN
+#undef BENCH_OP
+#undef BENCH_LOCK
+#undef BENCH_LOCK_T
+#undef BENCH_WAKE_TOKENS
+#undef BENCH_WAKE_BCAST
@@ -0,0 +1,236 @@
+/**
+ * @file bench_workload.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Critical-section and think-time workload model for the contended cases.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * A workload is a critical-section length, a think time spent outside the
+ * lock, and a number of shared cache lines read and written under the lock.
+ * Lengths are drawn per acquisition from a distribution given as
+ *
+ *   N            fixed, N ns
+ *   exp:N        exponential with mean N ns
+ *   trace:FILE   uniformly from the values (ns, whitespace separated) in FILE
+ *
+ * Time is spent in a calibrated busy loop rather than by reading a clock,
+ * so short sections do not pay for the clock.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCH_WORKLOAD_H
+#define BENCH_WORKLOAD_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#ifndef BENCH_WL_CALIBRATE
+#define BENCH_WL_CALIBRATE 50000000 // busy-loop iterations timed at start-up
+#endif
+
+enum bench_dist_kind
+{
+    BENCH_DIST_NONE,
+    BENCH_DIST_FIXED,
+    BENCH_DIST_EXP,
+    BENCH_DIST_TRACE,
+};
+
+/**
+ * @brief A distribution of lengths in ns.
+ */
+struct bench_dist
+{
+    int kind;
+    double mean;     // fixed value or exponential mean; the trace's mean for traces
+    uint64_t *trace; // trace values
+    size_t n;
+    char spec[96];   // as given on the command line
+};
+
+/**
+ * @brief The workload, set up once by bench_wl_init().
+ */
+static struct
+{
+    int on;
+    struct bench_dist cs;    // critical-section length
+    struct bench_dist think; // time outside the lock between acquisitions
+    int lines;               // shared cache lines written under the lock
+    uint64_t *data;          // lines * 64 bytes, one counter per line
+    double iters_per_ns;     // busy-loop speed
+} bench_wl;
+
+static inline uint64_t bench_rng(uint64_t *s) // xorshift64
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+/**
+ * @brief Parses a distribution spec (see the file comment).
+ *
+ * @return 0 on success, -1 if spec is malformed or the trace is unreadable,
+ * empty or too large to load.
+ */
+static inline int bench_dist_parse(struct bench_dist *d, const char *spec)
+{
+    char *end;
+    memset(d, 0, sizeof(*d));
+    snprintf(d->spec, sizeof(d->spec), "%s", spec);
+    if (strncmp(spec, "trace:", 6) == 0)
+    {
+        FILE *fp = fopen(spec + 6, "r");
+        if (fp == NULL)
+            return -1;
+        size_t cap = 0;
+        double sum = 0;
+        unsigned long long v;
+        while (fscanf(fp, "%llu", &v) == 1)
+        {
+            if (d->n == cap)
+            {
+                cap = cap ? cap * 2 : 1024;
+                uint64_t *t = (uint64_t *)realloc(d->trace, cap * sizeof(uint64_t));
+                if (t == NULL)
+                {
+                    fclose(fp);
+                    free(d->trace);
+                    d->trace = NULL;
+                    d->n = 0;
+                    return -1;
+                }
+                d->trace = t;
+            }
+            d->trace[d->n++] = v;
+            sum += v;
+        }
+        fclose(fp);
+        if (d->n == 0)
+        {
+            free(d->trace);
+            d->trace = NULL;
+            return -1;
+        }
+        d->kind = BENCH_DIST_TRACE;
+        d->mean = sum / d->n;
+        return 0;
+    }
+    d->kind = BENCH_DIST_FIXED;
+    if (strncmp(spec, "exp:", 4) == 0)
+    {
+        d->kind = BENCH_DIST_EXP;
+        spec += 4;
+    }
+    d->mean = strtod(spec, &end);
+    if (end == spec || *end != '\0' || d->mean < 0 || (d->kind == BENCH_DIST_EXP && d->mean <= 0))
+    {
+        d->kind = BENCH_DIST_NONE;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @return A length in ns drawn from d, using the caller's RNG state.
+ */
+static inline uint64_t bench_dist_sample(const struct bench_dist *d, uint64_t *rng)
+{
+    switch (d->kind)
+    {
+    case BENCH_DIST_FIXED:
+        return (uint64_t)d->mean;
+    case BENCH_DIST_EXP:
+    {
+        double u = ((bench_rng(rng) >> 11) + 1) * (1.0 / 9007199254740992.0); // (0, 1]
+        return (uint64_t)(-d->mean * log(u));
+    }
+    case BENCH_DIST_TRACE:
+        return d->trace[bench_rng(rng) % d->n];
+    default:
+        return 0;
+    }
+}
+
+static inline void bench_wl_loop(uint64_t iters)
+{
+    while (iters--)
+        __asm__ __volatile__("" ::: "memory");
+}
+
+/**
+ * @brief Busy-waits for about ns nanoseconds.
+ */
+static inline void bench_spin_ns(uint64_t ns)
+{
+    bench_wl_loop((uint64_t)(ns * bench_wl.iters_per_ns));
+}
+
+/**
+ * @brief Reads and writes every shared line; call with the lock held.
+ */
+static inline void bench_wl_touch(void)
+{
+    for (int i = 0; i < bench_wl.lines; i++)
+        bench_wl.data[i * 8]++;
+}
+
+/**
+ * @brief Allocates the shared lines and calibrates the busy loop. Call once
+ * the distributions and line count are set.
+ *
+ * @return 0 on success, -1 if the lines cannot be allocated.
+ */
+static inline int bench_wl_init(void)
+{
+    if (bench_wl.lines > 0)
+    {
+        void *mem = NULL;
+        if (posix_memalign(&mem, 64, bench_wl.lines * 64) != 0)
+            return -1;
+        memset(mem, 0, bench_wl.lines * 64);
+        bench_wl.data = (uint64_t *)mem;
+    }
+
+    struct timespec a, b;
+    bench_wl_loop(BENCH_WL_CALIBRATE / 10); // warm up
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    bench_wl_loop(BENCH_WL_CALIBRATE);
+    clock_gettime(CLOCK_MONOTONIC, &b);
+    double ns = (b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec);
+    bench_wl.iters_per_ns = BENCH_WL_CALIBRATE / ns;
+    bench_wl.on = 1;
+    return 0;
+}
+
+/**
+ * @brief Describes the workload, e.g. "cs=exp:500 think=2000 lines=4".
+ */
+static inline void bench_wl_describe(char *buf, size_t len)
+{
+    snprintf(buf, len, "cs=%.40s think=%.40s lines=%d", bench_wl.cs.kind ? bench_wl.cs.spec : "0",
+             bench_wl.think.kind ? bench_wl.think.spec : "0", bench_wl.lines);
+}
+
+#endif // BENCH_WORKLOAD_H
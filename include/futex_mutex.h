@@ -0,0 +1,128 @@
+/**
+ * @file futex_mutex.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Spin-then-park mutex built directly on futex(2). Linux only.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * The lock word is 0 (free), 1 (held) or 2 (held, maybe with sleepers), as
+ * in Drepper's "Futexes Are Tricky". A contended lock() first spins for a
+ * budget of either spin_iters polls or spin_ns nanoseconds, then parks in
+ * the kernel. unlock() only makes a syscall when someone may be parked.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FUTEX_MUTEX_H
+#define FUTEX_MUTEX_H
+
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "spinlock.h"
+
+#define FUTEX_SPIN_DEFAULT 100 // polls, close to glibc's adaptive default
+
+typedef struct
+{
+    uint32_t state;
+    uint32_t spin_iters; // polls before parking, used when spin_ns is 0
+    uint64_t spin_ns;    // time to spin before parking, 0 to count polls
+} futex_mutex_t;
+
+static inline long futex_wait(uint32_t *addr, uint32_t val)
+{
+    return syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static inline long futex_wake(uint32_t *addr, int n)
+{
+    return syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+static inline void futex_mutex_init(futex_mutex_t *m, uint32_t spin_iters, uint64_t spin_ns)
+{
+    __atomic_store_n(&m->state, 0, __ATOMIC_RELAXED);
+    m->spin_iters = spin_iters;
+    m->spin_ns = spin_ns;
+}
+
+static inline void futex_mutex_destroy(futex_mutex_t *m) { (void)m; }
+
+static inline int futex_mutex_trylock(futex_mutex_t *m)
+{
+    uint32_t c = 0;
+    return __atomic_compare_exchange_n(&m->state, &c, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) ? 0 : EBUSY;
+}
+
+/**
+ * @brief Polls for the lock to become free, within the spin budget.
+ *
+ * @return 0 if the lock was taken while spinning.
+ */
+static inline int futex_mutex_spin(futex_mutex_t *m)
+{
+    if (m->spin_ns == 0)
+    {
+        for (uint32_t i = 0; i < m->spin_iters; i++)
+        {
+            if (__atomic_load_n(&m->state, __ATOMIC_RELAXED) == 0 && futex_mutex_trylock(m) == 0)
+                return 0;
+            cpu_relax();
+        }
+        return EBUSY;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t deadline = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec + m->spin_ns;
+    for (;;)
+    {
+        // the clock is only read every 16 polls to keep the poll loop tight
+        for (int i = 0; i < 16; i++)
+        {
+            if (__atomic_load_n(&m->state, __ATOMIC_RELAXED) == 0 && futex_mutex_trylock(m) == 0)
+                return 0;
+            cpu_relax();
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if ((uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec >= deadline)
+            return EBUSY;
+    }
+}
+
+static inline void futex_mutex_lock(futex_mutex_t *m)
+{
+    if (futex_mutex_trylock(m) == 0)
+        return;
+    if (futex_mutex_spin(m) == 0)
+        return;
+    // park: mark the lock contended so the holder knows to wake us
+    while (__atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE) != 0)
+        futex_wait(&m->state, 2);
+}
+
+static inline void futex_mutex_unlock(futex_mutex_t *m)
+{
+    if (__atomic_exchange_n(&m->state, 0, __ATOMIC_RELEASE) == 2)
+        futex_wake(&m->state, 1);
+}
+
+#endif // FUTEX_MUTEX_H
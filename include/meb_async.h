@@ -0,0 +1,387 @@
+/**
+ * @file meb_async.h
+ * @author Mit Bailey (mitbailey99@gmail.com)
+ * @brief Asynchronous backend for the meb_print.h macros.
+ * @version See Git tags for version information.
+ * @date 2021.07.26
+ *
+ * Included by meb_print.h when MEB_ASYNC is defined; do not include it
+ * directly. The print macros keep their names and arguments, but instead
+ * of printf() and fflush() on the calling thread they format into a slot of
+ * a per-thread single-producer/single-consumer ring and return. A
+ * background writer thread, started on first use, drains every ring in
+ * the order the records were made and writes them out. The writer sleeps
+ * when idle (up to MEB_ASYNC_IDLE_MS) and producers never wake it, so
+ * logging costs no system call on the calling thread.
+ *
+ * A full ring makes its producer yield until the writer catches up;
+ * nothing is dropped. Records longer than MEB_ASYNC_MSG are truncated.
+ * Everything left is written at exit, or on meb_flush().
+ *
+ * The shared state is defined weak, so every translation unit that
+ * includes this header shares one writer.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MEB_ASYNC_H
+#define MEB_ASYNC_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#ifndef MEB_ASYNC_SLOTS
+#define MEB_ASYNC_SLOTS 256 // records per thread, a power of two
+#endif
+#ifndef MEB_ASYNC_MSG
+#define MEB_ASYNC_MSG 512 // bytes per record, longer records are truncated
+#endif
+#ifndef MEB_ASYNC_IDLE_MS
+#define MEB_ASYNC_IDLE_MS 50 // longest the writer sleeps between polls
+#endif
+
+#define MEB_ASYNC_STOPPED 0
+#define MEB_ASYNC_RUNNING 1
+#define MEB_ASYNC_STOPPING 2
+
+struct meb_rec
+{
+    uint64_t seq; // global order the record was made in
+    int stream;   // 1 for stdout, 2 for stderr
+    int len;
+    char text[MEB_ASYNC_MSG];
+};
+
+struct meb_ring
+{
+    uint64_t head __attribute__((aligned(64))); // written by the owning thread
+    uint64_t tail __attribute__((aligned(64))); // written by the writer
+    struct meb_ring *next;
+    int dead; // the owner has exited, free once drained
+    struct meb_rec slots[MEB_ASYNC_SLOTS];
+};
+
+struct meb_async_state
+{
+    struct meb_ring *rings; // threads push at the front, only the writer unlinks
+    uint64_t seq;           // records made
+    uint64_t written;       // records written
+    int state;
+    pthread_t writer;
+    pthread_once_t once;
+    pthread_key_t key;
+    pthread_mutex_t lock; // only for the writer's sleep and meb_flush()
+    pthread_cond_t cond;
+};
+
+__attribute__((weak)) struct meb_async_state meb_async = {NULL, 0, 0, MEB_ASYNC_STOPPED, 0, PTHREAD_ONCE_INIT, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+__attribute__((weak)) __thread struct meb_ring *meb_ring_self = NULL;
+
+static inline void meb_ring_exit(void *r)
+{
+    __atomic_store_n(&((struct meb_ring *)r)->dead, 1, __ATOMIC_RELEASE);
+    meb_ring_self = NULL; // a later record on this thread gets a new ring
+}
+
+/**
+ * @brief Unlinks and frees the rings of exited threads that are drained.
+ */
+static inline void meb_async_prune(void)
+{
+    struct meb_ring *prev = NULL;
+    struct meb_ring *r = __atomic_load_n(&meb_async.rings, __ATOMIC_ACQUIRE);
+    while (r != NULL)
+    {
+        struct meb_ring *next = r->next;
+        if (__atomic_load_n(&r->dead, __ATOMIC_ACQUIRE) && r->tail == __atomic_load_n(&r->head, __ATOMIC_ACQUIRE))
+        {
+            if (prev != NULL)
+            {
+                prev->next = next;
+                free(r);
+                r = next;
+                continue;
+            }
+            // at the front, a new thread may be pushing; leave it for later if so
+            struct meb_ring *expected = r;
+            if (__atomic_compare_exchange_n(&meb_async.rings, &expected, next, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            {
+                free(r);
+                r = next;
+                continue;
+            }
+        }
+        prev = r;
+        r = next;
+    }
+}
+
+/**
+ * @brief Writes out every record that has been made so far, oldest first.
+ * Only one thread may drain at a time.
+ *
+ * @return The number of records written.
+ */
+static inline uint64_t meb_async_drain(void)
+{
+    uint64_t n = 0;
+    for (;;)
+    {
+        struct meb_ring *best = NULL;
+        struct meb_rec *rec = NULL;
+        for (struct meb_ring *r = __atomic_load_n(&meb_async.rings, __ATOMIC_ACQUIRE); r != NULL; r = r->next)
+        {
+            if (r->tail == __atomic_load_n(&r->head, __ATOMIC_ACQUIRE))
+                continue;
+            struct meb_rec *head = &r->slots[r->tail & (MEB_ASYNC_SLOTS - 1)];
+            if (rec == NULL || head->seq < rec->seq)
+            {
+                best = r;
+                rec = head;
+            }
+        }
+        if (best == NULL)
+            break;
+        FILE *fp = rec->stream == 2 ? stderr : stdout;
+        if (fp == stderr)
+            fflush(stdout); // keep stdout and stderr in order on a shared terminal
+        fwrite(rec->text, 1, rec->len, fp);
+        __atomic_store_n(&best->tail, best->tail + 1, __ATOMIC_RELEASE);
+        n++;
+    }
+    if (n > 0)
+    {
+        fflush(stdout);
+        fflush(stderr);
+        __atomic_add_fetch(&meb_async.written, n, __ATOMIC_RELEASE);
+    }
+    meb_async_prune();
+    return n;
+}
+
+static inline void meb_async_sleep(long ms)
+{
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += ms / 1000;
+    until.tv_nsec += (ms % 1000) * 1000000L;
+    if (until.tv_nsec >= 1000000000L)
+    {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+    pthread_mutex_lock(&meb_async.lock);
+    pthread_cond_timedwait(&meb_async.cond, &meb_async.lock, &until);
+    pthread_mutex_unlock(&meb_async.lock);
+}
+
+static inline void *meb_async_writer(void *arg)
+{
+    (void)arg;
+    long idle_ms = 1;
+    for (;;)
+    {
+        int stopping = __atomic_load_n(&meb_async.state, __ATOMIC_ACQUIRE) == MEB_ASYNC_STOPPING;
+        if (meb_async_drain() > 0)
+        {
+            idle_ms = 1;
+            pthread_mutex_lock(&meb_async.lock);
+            pthread_cond_broadcast(&meb_async.cond); // for meb_flush()
+            pthread_mutex_unlock(&meb_async.lock);
+            continue;
+        }
+        if (stopping)
+            break;
+        meb_async_sleep(idle_ms);
+        idle_ms = idle_ms * 2 > MEB_ASYNC_IDLE_MS ? MEB_ASYNC_IDLE_MS : idle_ms * 2;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Stops the writer once everything made so far is written. Records
+ * made afterwards are printed synchronously.
+ */
+static inline void meb_async_stop(void)
+{
+    int running = MEB_ASYNC_RUNNING;
+    if (!__atomic_compare_exchange_n(&meb_async.state, &running, MEB_ASYNC_STOPPING, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return;
+    pthread_mutex_lock(&meb_async.lock);
+    pthread_cond_broadcast(&meb_async.cond);
+    pthread_mutex_unlock(&meb_async.lock);
+    pthread_join(meb_async.writer, NULL);
+    __atomic_store_n(&meb_async.state, MEB_ASYNC_STOPPED, __ATOMIC_RELEASE);
+    meb_async_drain(); // anything that raced with the stop
+}
+
+static inline void meb_async_start(void)
+{
+    pthread_key_create(&meb_async.key, meb_ring_exit);
+    __atomic_store_n(&meb_async.state, MEB_ASYNC_RUNNING, __ATOMIC_RELEASE);
+    if (pthread_create(&meb_async.writer, NULL, meb_async_writer, NULL) != 0)
+    {
+        __atomic_store_n(&meb_async.state, MEB_ASYNC_STOPPED, __ATOMIC_RELEASE);
+        return;
+    }
+    atexit(meb_async_stop);
+}
+
+/**
+ * @brief Returns the calling thread's ring, creating it on first use, or
+ * NULL if records should be printed synchronously.
+ */
+static inline struct meb_ring *meb_ring_get(void)
+{
+    struct meb_ring *r = meb_ring_self;
+    if (r != NULL)
+        return r;
+    pthread_once(&meb_async.once, meb_async_start);
+    if (__atomic_load_n(&meb_async.state, __ATOMIC_ACQUIRE) != MEB_ASYNC_RUNNING)
+        return NULL;
+
+    void *mem = NULL;
+    if (posix_memalign(&mem, 64, sizeof(struct meb_ring)) != 0)
+        return NULL;
+    r = (struct meb_ring *)mem;
+    r->head = 0;
+    r->tail = 0;
+    r->dead = 0;
+    r->next = __atomic_load_n(&meb_async.rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&meb_async.rings, &r->next, r, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+    pthread_setspecific(meb_async.key, r);
+    meb_ring_self = r;
+    return r;
+}
+
+/**
+ * @brief Formats a record into the calling thread's ring.
+ *
+ * @param stream 1 for stdout, 2 for stderr.
+ * @return The untruncated length of the record, as printf() would.
+ */
+__attribute__((format(printf, 2, 3))) static inline int meb_async_printf(int stream, const char *format, ...)
+{
+    va_list ap;
+    int len;
+    struct meb_ring *r = meb_ring_get();
+    if (r != NULL)
+    {
+        while (r->head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) >= MEB_ASYNC_SLOTS &&
+               __atomic_load_n(&meb_async.state, __ATOMIC_ACQUIRE) != MEB_ASYNC_STOPPED)
+            sched_yield();
+        if (__atomic_load_n(&meb_async.state, __ATOMIC_ACQUIRE) == MEB_ASYNC_STOPPED)
+            r = NULL;
+    }
+    if (r == NULL)
+    {
+        FILE *fp = stream == 2 ? stderr : stdout;
+        va_start(ap, format);
+        len = vfprintf(fp, format, ap);
+        va_end(ap);
+        fflush(fp);
+        return len;
+    }
+
+    struct meb_rec *rec = &r->slots[r->head & (MEB_ASYNC_SLOTS - 1)];
+    va_start(ap, format);
+    len = vsnprintf(rec->text, MEB_ASYNC_MSG, format, ap);
+    va_end(ap);
+    rec->len = len < 0 ? 0 : (len >= MEB_ASYNC_MSG ? MEB_ASYNC_MSG - 1 : len);
+    rec->stream = stream;
+    rec->seq = __atomic_fetch_add(&meb_async.seq, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->head, r->head + 1, __ATOMIC_RELEASE);
+    return len;
+}
+
+/**
+ * @brief Waits until every record made before the call has been written.
+ */
+static inline void meb_flush(void)
+{
+    uint64_t target = __atomic_load_n(&meb_async.seq, __ATOMIC_ACQUIRE);
+    pthread_mutex_lock(&meb_async.lock);
+    while (__atomic_load_n(&meb_async.written, __ATOMIC_ACQUIRE) < target &&
+           __atomic_load_n(&meb_async.state, __ATOMIC_ACQUIRE) == MEB_ASYNC_RUNNING)
+    {
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_nsec += 1000000L;
+        if (until.tv_nsec >= 1000000000L)
+        {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_broadcast(&meb_async.cond); // wake the writer
+        pthread_cond_timedwait(&meb_async.cond, &meb_async.lock, &until);
+    }
+    pthread_mutex_unlock(&meb_async.lock);
+    fflush(stdout);
+    fflush(stderr);
+}
+
+#ifndef dbprintlf
+#define dbprintlf(format, ...)                                                                                             \
+    {                                                                                                                      \
+        if (MEB_DBGLVL & MEB_DBG_DBPRINT)                                                                                  \
+            meb_async_printf(2, "[%s:%d | %s] " format TERMINATOR "\n", __FILE__, __LINE__, __func__, ##__VA_ARGS__);      \
+    }
+#endif // dbprintlf
+
+#ifndef dbprintf
+#define dbprintf(format, ...)                                                                                         \
+    {                                                                                                                 \
+        if (MEB_DBGLVL & MEB_DBG_DBPRINT)                                                                             \
+            meb_async_printf(2, "[%s:%d | %s] " format TERMINATOR, __FILE__, __LINE__, __func__, ##__VA_ARGS__);      \
+    }
+#endif // dbprintf
+
+#ifndef bprintf
+#define bprintf(str, ...) \
+    ((MEB_DBGLVL & MEB_DBG_BPRINT) ? meb_async_printf(1, str TERMINATOR, ##__VA_ARGS__) : 0)
+#endif // bprintf
+
+#ifndef bprintlf
+#define bprintlf(str, ...) \
+    ((MEB_DBGLVL & MEB_DBG_BPRINT) ? meb_async_printf(1, str TERMINATOR " \n", ##__VA_ARGS__) : 0)
+#endif // bprintlf
+
+#ifndef erprintlf
+#define erprintlf(error)                                                                                   \
+    {                                                                                                      \
+        if (MEB_DBGLVL & MEB_DBG_ERPRINT)                                                                  \
+            meb_async_printf(2, "[%s:%d | %s] " RED_FG "ERRNO >>> %d:" RESET_ALL " %s" TERMINATOR "\n", \
+                             __FILE__, __LINE__, __func__, error, strerror(error));                        \
+    }
+#endif // erprintlf
+
+#ifndef tprintf
+#define tprintf(str, ...)                                                                 \
+    {                                                                                     \
+        if (MEB_DBGLVL & MEB_DBG_TPRINT)                                                  \
+            meb_async_printf(1, "%s" str TERMINATOR, get_time_now(), ##__VA_ARGS__);     \
+    }
+#endif // tprintf
+
+#endif // MEB_ASYNC_H
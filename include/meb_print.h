@@ -6,6 +6,10 @@
  * @date 2021.07.26
  *
  * With revisions by Sunip K. Mukherjee (sunipkmukherjee@gmail.com).
+ *
+ * Define MEB_ASYNC to have the print macros hand their output to a
+ * background writer thread instead of printing on the calling thread (see
+ * meb_async.h). Call meb_flush() to wait for pending output either way.
  * 
  * @copyright Copyright (c) 2021
  *
@@ -118,6 +122,16 @@
 #endif // MEB_CODES
 #endif // defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
 
+#if defined(MEB_ASYNC) && !defined(OS_Windows)
+#include "meb_async.h"
+#else
+static inline void meb_flush(void)
+{
+    fflush(stdout);
+    fflush(stderr);
+}
+#endif // MEB_ASYNC
+
 #ifndef dbprintlf
 #define dbprintlf(format, ...)                                                                                    \
     {                                                                                                             \
@@ -0,0 +1,106 @@
+/**
+ * @file owner_mutex.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Recursive mutex that handles re-entry without atomics.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * A plain (non-recursive) pthread mutex guards the lock. On top of it, the
+ * owner field holds the owning thread's ID and count holds the recursion
+ * depth. A thread's ID is the address of one of its thread-local
+ * variables, so it costs nothing to look up. Re-entry compares owner with
+ * that ID and bumps the counter, and touches no atomic read-modify-write
+ * or the inner mutex.
+ *
+ * Only the owner ever writes its own ID into owner, and it clears it before
+ * releasing the inner mutex. Another thread may therefore read a stale
+ * owner, but never its own ID, so relaxed loads and stores are enough.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef OWNER_MUTEX_H
+#define OWNER_MUTEX_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+typedef struct
+{
+    pthread_mutex_t inner;
+    uintptr_t owner; // ID of the owning thread, 0 when free
+    unsigned count;  // recursion depth, only touched by the owner
+} owner_mutex_t;
+
+static __thread char owner_mutex_tag; // its address is the thread's ID
+
+static inline uintptr_t owner_mutex_self(void)
+{
+    return (uintptr_t)&owner_mutex_tag;
+}
+
+static inline void owner_mutex_init(owner_mutex_t *m)
+{
+    pthread_mutex_init(&m->inner, NULL);
+    __atomic_store_n(&m->owner, 0, __ATOMIC_RELAXED);
+    m->count = 0;
+}
+
+static inline void owner_mutex_destroy(owner_mutex_t *m) { pthread_mutex_destroy(&m->inner); }
+
+static inline void owner_mutex_lock(owner_mutex_t *m)
+{
+    uintptr_t me = owner_mutex_self();
+    if (__atomic_load_n(&m->owner, __ATOMIC_RELAXED) == me)
+    {
+        m->count++;
+        return;
+    }
+    pthread_mutex_lock(&m->inner);
+    __atomic_store_n(&m->owner, me, __ATOMIC_RELAXED);
+    m->count = 1;
+}
+
+/**
+ * @return 0 on success, nonzero if another thread holds the lock.
+ */
+static inline int owner_mutex_trylock(owner_mutex_t *m)
+{
+    uintptr_t me = owner_mutex_self();
+    if (__atomic_load_n(&m->owner, __ATOMIC_RELAXED) == me)
+    {
+        m->count++;
+        return 0;
+    }
+    int ret = pthread_mutex_trylock(&m->inner);
+    if (ret == 0)
+    {
+        __atomic_store_n(&m->owner, me, __ATOMIC_RELAXED);
+        m->count = 1;
+    }
+    return ret;
+}
+
+static inline void owner_mutex_unlock(owner_mutex_t *m)
+{
+    if (--m->count != 0)
+        return;
+    __atomic_store_n(&m->owner, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&m->inner);
+}
+
+#endif // OWNER_MUTEX_H
@@ -0,0 +1,88 @@
+/**
+ * @file seqlock.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Sequence lock: writers serialize on a spinlock, readers never write.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * The sequence is odd while a write is in progress. A reader notes the
+ * sequence, reads the protected data, and retries if the sequence moved in
+ * between, so the data must be read with atomic (relaxed) loads and written
+ * with atomic stores:
+ *
+ *   unsigned s;
+ *   do
+ *   {
+ *       s = seqlock_read_begin(l);
+ *       ...copy the data...
+ *   } while (seqlock_read_retry(l, s));
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include "spinlock.h"
+
+typedef struct
+{
+    unsigned seq;
+    ttas_lock_t writer;
+} seqlock_t;
+
+static inline void seqlock_init(seqlock_t *l)
+{
+    __atomic_store_n(&l->seq, 0, __ATOMIC_RELAXED);
+    ttas_init(&l->writer);
+}
+
+static inline void seqlock_destroy(seqlock_t *l) { ttas_destroy(&l->writer); }
+
+static inline void seqlock_wrlock(seqlock_t *l)
+{
+    ttas_lock(&l->writer);
+    __atomic_store_n(&l->seq, __atomic_load_n(&l->seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    // the odd sequence must be visible before any of the data stores
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void seqlock_wrunlock(seqlock_t *l)
+{
+    __atomic_store_n(&l->seq, __atomic_load_n(&l->seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+    ttas_unlock(&l->writer);
+}
+
+static inline unsigned seqlock_read_begin(const seqlock_t *l)
+{
+    unsigned s;
+    while ((s = __atomic_load_n(&l->seq, __ATOMIC_ACQUIRE)) & 1)
+        cpu_relax();
+    return s;
+}
+
+/**
+ * @return Nonzero if a writer ran since seqlock_read_begin() returned s.
+ */
+static inline int seqlock_read_retry(const seqlock_t *l, unsigned s)
+{
+    // keep the data loads before the second sequence load
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&l->seq, __ATOMIC_RELAXED) != s;
+}
+
+#endif // SEQLOCK_H
@@ -0,0 +1,316 @@
+/**
+ * @file spinlock.h
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief User-space spinlocks: TAS, TTAS, ticket, MCS and CLH.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * Header-only, built on the GCC __atomic builtins so that the same code is
+ * used from C and C++. trylock functions return 0 on success and EBUSY
+ * otherwise, like pthread_mutex_trylock.
+ *
+ * The queue locks need a per-thread node: MCS takes the node the caller
+ * will spin on, CLH takes a clh_thread handle whose node changes hands on
+ * every release.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifndef SPIN_CACHELINE
+#define SPIN_CACHELINE 64
+#endif
+
+/**
+ * @brief Tells the CPU we are in a spin-wait loop.
+ */
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+// Test-and-set: every attempt is an atomic exchange.
+
+typedef struct
+{
+    int locked;
+} tas_lock_t;
+
+static inline void tas_init(tas_lock_t *l) { __atomic_store_n(&l->locked, 0, __ATOMIC_RELAXED); }
+
+static inline void tas_destroy(tas_lock_t *l) { (void)l; }
+
+static inline int tas_trylock(tas_lock_t *l)
+{
+    return __atomic_exchange_n(&l->locked, 1, __ATOMIC_ACQUIRE) ? EBUSY : 0;
+}
+
+static inline void tas_lock(tas_lock_t *l)
+{
+    while (__atomic_exchange_n(&l->locked, 1, __ATOMIC_ACQUIRE))
+        cpu_relax();
+}
+
+static inline void tas_unlock(tas_lock_t *l) { __atomic_store_n(&l->locked, 0, __ATOMIC_RELEASE); }
+
+// Test-and-test-and-set: spin on a plain load, only exchange when it looks free.
+
+typedef struct
+{
+    int locked;
+} ttas_lock_t;
+
+static inline void ttas_init(ttas_lock_t *l) { __atomic_store_n(&l->locked, 0, __ATOMIC_RELAXED); }
+
+static inline void ttas_destroy(ttas_lock_t *l) { (void)l; }
+
+static inline int ttas_trylock(ttas_lock_t *l)
+{
+    if (__atomic_load_n(&l->locked, __ATOMIC_RELAXED))
+        return EBUSY;
+    return __atomic_exchange_n(&l->locked, 1, __ATOMIC_ACQUIRE) ? EBUSY : 0;
+}
+
+static inline void ttas_lock(ttas_lock_t *l)
+{
+    for (;;)
+    {
+        if (!__atomic_exchange_n(&l->locked, 1, __ATOMIC_ACQUIRE))
+            return;
+        while (__atomic_load_n(&l->locked, __ATOMIC_RELAXED))
+            cpu_relax();
+    }
+}
+
+static inline void ttas_unlock(ttas_lock_t *l) { __atomic_store_n(&l->locked, 0, __ATOMIC_RELEASE); }
+
+// Ticket: FIFO, take a number and wait for it to be served.
+
+typedef struct
+{
+    unsigned next;
+    unsigned owner;
+} ticket_lock_t;
+
+static inline void ticket_init(ticket_lock_t *l)
+{
+    __atomic_store_n(&l->next, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&l->owner, 0, __ATOMIC_RELAXED);
+}
+
+static inline void ticket_destroy(ticket_lock_t *l) { (void)l; }
+
+static inline int ticket_trylock(ticket_lock_t *l)
+{
+    unsigned owner = __atomic_load_n(&l->owner, __ATOMIC_RELAXED);
+    unsigned expected = owner;
+    // only take a ticket if it would be served immediately
+    return __atomic_compare_exchange_n(&l->next, &expected, owner + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) ? 0 : EBUSY;
+}
+
+static inline void ticket_lock(ticket_lock_t *l)
+{
+    unsigned me = __atomic_fetch_add(&l->next, 1, __ATOMIC_RELAXED);
+    while (__atomic_load_n(&l->owner, __ATOMIC_ACQUIRE) != me)
+        cpu_relax();
+}
+
+static inline void ticket_unlock(ticket_lock_t *l)
+{
+    // only the holder writes owner
+    __atomic_store_n(&l->owner, __atomic_load_n(&l->owner, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+}
+
+// MCS: FIFO queue, each waiter spins on its own node.
+
+struct mcs_node
+{
+    struct mcs_node *next;
+    int locked;
+} __attribute__((aligned(SPIN_CACHELINE)));
+
+typedef struct
+{
+    struct mcs_node *tail;
+} mcs_lock_t;
+
+static inline void mcs_init(mcs_lock_t *l) { __atomic_store_n(&l->tail, (struct mcs_node *)NULL, __ATOMIC_RELAXED); }
+
+static inline void mcs_destroy(mcs_lock_t *l) { (void)l; }
+
+static inline int mcs_trylock(mcs_lock_t *l, struct mcs_node *me)
+{
+    struct mcs_node *expected = NULL;
+    me->next = NULL;
+    return __atomic_compare_exchange_n(&l->tail, &expected, me, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) ? 0 : EBUSY;
+}
+
+static inline void mcs_lock(mcs_lock_t *l, struct mcs_node *me)
+{
+    me->next = NULL;
+    me->locked = 1;
+    struct mcs_node *prev = __atomic_exchange_n(&l->tail, me, __ATOMIC_ACQ_REL);
+    if (prev == NULL)
+        return;
+    __atomic_store_n(&prev->next, me, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&me->locked, __ATOMIC_ACQUIRE))
+        cpu_relax();
+}
+
+static inline void mcs_unlock(mcs_lock_t *l, struct mcs_node *me)
+{
+    struct mcs_node *next = __atomic_load_n(&me->next, __ATOMIC_ACQUIRE);
+    if (next == NULL)
+    {
+        struct mcs_node *expected = me;
+        if (__atomic_compare_exchange_n(&l->tail, &expected, (struct mcs_node *)NULL, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            return;
+        // a successor is between its exchange and linking itself in
+        while ((next = __atomic_load_n(&me->next, __ATOMIC_ACQUIRE)) == NULL)
+            cpu_relax();
+    }
+    __atomic_store_n(&next->locked, 0, __ATOMIC_RELEASE);
+}
+
+// CLH: FIFO queue, each waiter spins on its predecessor's node and takes it
+// over on release. Nodes migrate between threads, and clh_trylock may read
+// a node another thread has just given up, so nodes are recycled through a
+// process-wide pool instead of being returned to malloc.
+
+struct clh_node
+{
+    int locked;
+    struct clh_node *pool_next;
+} __attribute__((aligned(SPIN_CACHELINE)));
+
+typedef struct
+{
+    struct clh_node *tail;
+} clh_lock_t;
+
+struct clh_thread
+{
+    struct clh_node *node;
+    struct clh_node *pred;
+};
+
+static pthread_mutex_t clh_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct clh_node *clh_pool = NULL;
+
+static inline struct clh_node *clh_node_alloc(void)
+{
+    pthread_mutex_lock(&clh_pool_lock);
+    struct clh_node *node = clh_pool;
+    if (node != NULL)
+        clh_pool = node->pool_next;
+    pthread_mutex_unlock(&clh_pool_lock);
+
+    if (node == NULL)
+    {
+        void *mem = NULL;
+        if (posix_memalign(&mem, SPIN_CACHELINE, sizeof(struct clh_node)) != 0)
+            return NULL;
+        node = (struct clh_node *)mem;
+    }
+    __atomic_store_n(&node->locked, 0, __ATOMIC_RELAXED);
+    return node;
+}
+
+static inline void clh_node_free(struct clh_node *node)
+{
+    if (node == NULL)
+        return;
+    pthread_mutex_lock(&clh_pool_lock);
+    node->pool_next = clh_pool;
+    clh_pool = node;
+    pthread_mutex_unlock(&clh_pool_lock);
+}
+
+static inline int clh_init(clh_lock_t *l)
+{
+    l->tail = clh_node_alloc();
+    return l->tail == NULL ? ENOMEM : 0;
+}
+
+/**
+ * @brief Releases the node left at the tail. The lock must be free.
+ */
+static inline void clh_destroy(clh_lock_t *l)
+{
+    clh_node_free(l->tail);
+    l->tail = NULL;
+}
+
+static inline int clh_thread_init(struct clh_thread *me)
+{
+    me->pred = NULL;
+    me->node = clh_node_alloc();
+    return me->node == NULL ? ENOMEM : 0;
+}
+
+static inline void clh_thread_destroy(struct clh_thread *me)
+{
+    clh_node_free(me->node);
+    me->node = NULL;
+}
+
+static inline int clh_trylock(clh_lock_t *l, struct clh_thread *me)
+{
+    struct clh_node *pred = __atomic_load_n(&l->tail, __ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&pred->locked, __ATOMIC_ACQUIRE))
+        return EBUSY;
+    __atomic_store_n(&me->node->locked, 1, __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&l->tail, &pred, me->node, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        return EBUSY;
+    // Once queued we cannot back out. pred was free when we looked, but if
+    // its node was recycled and re-queued in between, wait our turn.
+    while (__atomic_load_n(&pred->locked, __ATOMIC_ACQUIRE))
+        cpu_relax();
+    me->pred = pred;
+    return 0;
+}
+
+static inline void clh_lock(clh_lock_t *l, struct clh_thread *me)
+{
+    __atomic_store_n(&me->node->locked, 1, __ATOMIC_RELAXED);
+    struct clh_node *pred = __atomic_exchange_n(&l->tail, me->node, __ATOMIC_ACQ_REL);
+    while (__atomic_load_n(&pred->locked, __ATOMIC_ACQUIRE))
+        cpu_relax();
+    me->pred = pred;
+}
+
+static inline void clh_unlock(clh_lock_t *l, struct clh_thread *me)
+{
+    (void)l;
+    struct clh_node *node = me->node;
+    me->node = me->pred; // our predecessor's node is ours now
+    __atomic_store_n(&node->locked, 0, __ATOMIC_RELEASE);
+}
+
+#endif // SPINLOCK_H
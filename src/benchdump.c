@@ -0,0 +1,104 @@
+/**
+ * @file benchdump.c
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Prints a binary result file (see bench_bin.h) as text.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * benchdump.out [-b] FILE...
+ *
+ * Prints each file's header, then every block as a comment line followed
+ * by its rows as CSV. With -b, only the header and block lines are printed.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "bench_bin.h"
+#include "meb_print.h"
+
+static void dump_header(const char *path, const struct bench_bin_header *h)
+{
+    printf("# file: %s\n", path);
+    printf("# program: %s %s\n", h->program, h->args);
+    printf("# host: %s (%s, %" PRId32 " CPUs)\n", h->host, h->machine, h->ncpus);
+    printf("# kernel: %s\n", h->kernel);
+    printf("# compiler: %s\n", h->compiler);
+    printf("# start: %" PRIu64 " ns\n", h->start_ns);
+    printf("# settings: duration=%" PRId32 " ms trials=%" PRId32 " sweep_trials=%" PRId32 " cl_threads=%" PRId32 " cl_trials=%" PRId32 "\n",
+           h->trial_ms, h->trials, h->sweep_trials, h->cl_threads, h->cl_trials);
+}
+
+static void dump_block(const struct bench_bin_block *b, int rows)
+{
+    printf("## %s, %s, threads %" PRId32 ", layout %" PRId32 ", place %" PRId32 ", %" PRIu64 " rows\n",
+           b->name, b->kind, b->threads, b->layout, b->place, b->nrows);
+    if (!rows)
+        return;
+    for (uint32_t c = 0; c < b->ncols; c++)
+        printf(c ? ", %s" : "%s", b->cols[c].name);
+    printf("\n");
+    for (uint64_t r = 0; r < b->nrows; r++)
+    {
+        for (uint32_t c = 0; c < b->ncols; c++)
+        {
+            if (c)
+                printf(", ");
+            switch (b->cols[c].type)
+            {
+            case BENCH_BIN_I64:
+                printf("%" PRId64, bench_bin_i64(b, c)[r]);
+                break;
+            case BENCH_BIN_F64:
+                printf("%g", bench_bin_f64(b, c)[r]);
+                break;
+            default:
+                printf("%" PRIu64, bench_bin_u64(b, c)[r]);
+                break;
+            }
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int rows = 1, ret = 0;
+    for (int i = 1; i < argc; i++) // -b applies to every file, wherever it is given
+        if (strcmp(argv[i], "-b") == 0)
+            rows = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-b") == 0)
+            continue;
+
+        struct bench_bin_map m;
+        if (bench_bin_open(&m, argv[i]) != 0)
+        {
+            dbprintlf(RED_FG "%s is not a readable result file.", argv[i]);
+            ret = 1;
+            continue;
+        }
+        dump_header(argv[i], m.hdr);
+        for (const struct bench_bin_block *b = bench_bin_next(&m, NULL); b != NULL; b = bench_bin_next(&m, b))
+            dump_block(b, rows);
+        bench_bin_close(&m);
+    }
+    return ret;
+}
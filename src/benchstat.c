@@ -0,0 +1,585 @@
+/**
+ * @file benchstat.c
+ * @author Mit Bailey (mitbailey@outlook.com)
+ * @brief Summarizes trial results and compares locks with significance tests.
+ * @version See Git tags for version information.
+ * @date 2022.07.05
+ *
+ * benchstat.out [-w WARMUP] [-k K] [-b RESAMPLES] [-a ALPHA] [-g N] [-s SEED]
+ *               [-c A B]... FILE...
+ *
+ * Reads binary result files (.bench) and the text .data files, and groups
+ * trials by case. Every file is taken as one run. In each run, the first
+ * WARMUP trials of each case are dropped (default 1). Trials further than
+ * K scaled MADs from the median are rejected as outliers (default 3). Each
+ * case then gets its median, its MAD and a bootstrap confidence interval
+ * for the median.
+ *
+ * -c A B compares case A against case B, pooling the trials of every run.
+ * It reports the ratio of the medians with a bootstrap confidence interval
+ * and a Mann-Whitney U test. A beats B when the test is significant at
+ * ALPHA and the interval lies above 1.
+ *
+ * Cases are named "<case> <kind> x<threads>", e.g. "TAS rl x1". The old
+ * start/count/time .data files carry no case, so each file is one case
+ * named after the file; -g N splits such a file into cases of N trials.
+ * Every value is a rate, so higher is better.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <inttypes.h>
+#include "bench_bin.h"
+#include "meb_print.h"
+
+#define MAX_COMPARE 64
+
+struct group
+{
+    char label[160];
+    double *v;
+    int n;
+    int cap;
+    int run;      // last run (file) a trial was seen in
+    int run_seen; // trials seen in that run, warm-up included
+    int warm;     // trials dropped as warm-up
+};
+
+struct stats
+{
+    int n;
+    int rejected;
+    double median;
+    double mad;
+    double lo; // confidence interval of the median
+    double hi;
+    double *kept; // trials that passed outlier rejection, sorted
+};
+
+struct ranked
+{
+    double v;
+    int from_a;
+};
+
+static struct group *groups = NULL;
+static int ngroups = 0;
+
+static int opt_warmup = 1;
+static double opt_k = 3.0;
+static int opt_resamples = 10000;
+static double opt_alpha = 0.05;
+static int opt_split = 0;
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t rng_next(void) // xorshift64*, reproducible across runs
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545f4914f6cdd1dULL;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_ranked(const void *a, const void *b)
+{
+    return cmp_double(&((const struct ranked *)a)->v, &((const struct ranked *)b)->v);
+}
+
+static double median_sorted(const double *v, int n)
+{
+    if (n == 0)
+        return NAN;
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+static double median_of(double *v, int n)
+{
+    qsort(v, n, sizeof(double), cmp_double);
+    return median_sorted(v, n);
+}
+
+/**
+ * @brief Returns the group called label, creating it if needed.
+ */
+static struct group *group_get(const char *label)
+{
+    for (int i = 0; i < ngroups; i++)
+    {
+        if (strcmp(groups[i].label, label) == 0)
+            return &groups[i];
+    }
+    struct group *g = (struct group *)realloc(groups, (ngroups + 1) * sizeof(struct group));
+    if (g == NULL)
+    {
+        dbprintlf(FATAL "Out of memory.");
+        exit(4);
+    }
+    groups = g;
+    g = &groups[ngroups++];
+    memset(g, 0, sizeof(*g));
+    g->run = -1;
+    snprintf(g->label, sizeof(g->label), "%s", label);
+    return g;
+}
+
+/**
+ * @brief Adds one trial of run to the group called label, unless it is one
+ * of the run's warm-up trials for that group.
+ */
+static void trial_add(const char *label, int run, double value)
+{
+    struct group *g = group_get(label);
+    if (g->run != run)
+    {
+        g->run = run;
+        g->run_seen = 0;
+    }
+    if (g->run_seen++ < opt_warmup)
+    {
+        g->warm++;
+        return;
+    }
+    if (!isfinite(value))
+        return;
+    if (g->n == g->cap)
+    {
+        g->cap = g->cap ? g->cap * 2 : 32;
+        g->v = (double *)realloc(g->v, g->cap * sizeof(double));
+        if (g->v == NULL)
+        {
+            dbprintlf(FATAL "Out of memory.");
+            exit(4);
+        }
+    }
+    g->v[g->n++] = value;
+}
+
+static int load_bench(const char *path, int run)
+{
+    struct bench_bin_map m;
+    if (bench_bin_open(&m, path) != 0)
+        return -1;
+    for (const struct bench_bin_block *b = bench_bin_next(&m, NULL); b != NULL; b = bench_bin_next(&m, b))
+    {
+        int count = bench_bin_find(b, "count"), wall = bench_bin_find(b, "wall_ns");
+        if (count < 0 || wall < 0 || strncmp(b->kind, "lat_", 4) == 0)
+            continue;
+        // a trial's rate is the sum of its threads' rates
+        double rate = 0;
+        for (uint64_t r = 0; r < b->nrows; r++)
+        {
+            uint64_t ns = bench_bin_u64(b, wall)[r];
+            rate += ns ? bench_bin_u64(b, count)[r] / (ns * 1e-9) : NAN;
+        }
+        char label[160];
+        snprintf(label, sizeof(label), "%.64s %.16s x%" PRId32 "%s", b->name, b->kind, b->threads, b->layout ? " packed" : "");
+        trial_add(label, run, rate);
+    }
+    bench_bin_close(&m);
+    return 0;
+}
+
+/**
+ * @brief Splits line at ", " into at most max fields, in place.
+ */
+static int split_fields(char *line, char **field, int max)
+{
+    int n = 0;
+    line[strcspn(line, "\r\n")] = '\0';
+    while (n < max && *line != '\0')
+    {
+        field[n++] = line;
+        char *sep = strstr(line, ", ");
+        if (sep == NULL)
+            break;
+        *sep = '\0';
+        line = sep + 2;
+    }
+    return n;
+}
+
+static int load_data(const char *path, int run)
+{
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    char name[128];
+    snprintf(name, sizeof(name), "%s", base);
+    char *ext = strstr(name, ".data");
+    if (ext != NULL)
+        *ext = '\0';
+    const char *skip[] = {"_skew", "_layout", "_lat", "_topo", "_tl", "_tl_overshoot", "_pp", "_perf", "_fair", "_mutex", "_procs", "_depth", "_adapt", "_atomic", "_wake"};
+    for (unsigned i = 0; i < sizeof(skip) / sizeof(skip[0]); i++)
+    {
+        size_t len = strlen(name), slen = strlen(skip[i]);
+        if (len >= slen && strcmp(name + len - slen, skip[i]) == 0)
+        {
+            dbprintlf(YELLOW_FG "%s does not hold trials, skipping it.", path);
+            return 0;
+        }
+    }
+
+    size_t len = strlen(name);
+    int rw = len >= 3 && strcmp(name + len - 3, "_rw") == 0;
+    const char *kind = strrchr(name, '_') != NULL ? strrchr(name, '_') + 1 : name;
+    if (len >= 9 && strcmp(name + len - 9, "_sl_locks") == 0)
+        kind = "sl_locks";
+    else if (len >= 11 && strcmp(name + len - 11, "_sl_unlocks") == 0)
+        kind = "sl_unlocks";
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return -1;
+    char line[1024], label[160];
+    char *f[8];
+    int trial = 0;
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        int n = split_fields(line, f, 8);
+        if (n == 3) // start, count, time
+        {
+            if (opt_split > 0)
+                snprintf(label, sizeof(label), "%s #%d", name, trial / opt_split + 1);
+            else
+                snprintf(label, sizeof(label), "%s", name);
+            trial_add(label, run, strtod(f[1], NULL) / strtod(f[2], NULL));
+            trial++;
+        }
+        else if (n == 4) // rl, ul, sl_locks, sl_unlocks: case, start, count, time
+        {
+            snprintf(label, sizeof(label), "%.100s %.16s x1", f[0], kind);
+            trial_add(label, run, strtod(f[2], NULL) / strtod(f[3], NULL));
+        }
+        else if (n == 6) // rl: case, threads, aggregate/s, per-thread/s, min/s, max/s
+        {                // rw: case, threads, total/s, reads/s, writes/s, cpu
+            snprintf(label, sizeof(label), "%.100s %s x%s", f[0], rw ? "rw" : "rl", f[1]);
+            trial_add(label, run, strtod(f[2], NULL));
+        }
+        else if (n == 5) // case, threads, ops/s, cpu, ops per cpu-second
+        {
+            snprintf(label, sizeof(label), "%.100s cl x%s", f[0], f[1]);
+            trial_add(label, run, strtod(f[2], NULL));
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief Median, MAD, outlier rejection and a bootstrap interval for the
+ * median of g. st->kept must be freed by the caller.
+ */
+static void stats_compute(const struct group *g, struct stats *st)
+{
+    memset(st, 0, sizeof(*st));
+    st->median = st->mad = st->lo = st->hi = NAN;
+    if (g->n == 0)
+        return;
+
+    double *v = (double *)malloc(g->n * sizeof(double));
+    double *dev = (double *)malloc(g->n * sizeof(double));
+    if (v == NULL || dev == NULL)
+    {
+        dbprintlf(FATAL "Out of memory.");
+        exit(4);
+    }
+    memcpy(v, g->v, g->n * sizeof(double));
+    double med = median_of(v, g->n);
+    for (int i = 0; i < g->n; i++)
+        dev[i] = fabs(v[i] - med);
+    double mad = median_of(dev, g->n);
+
+    // 1.4826 * MAD estimates the standard deviation of normal data
+    int n = 0;
+    for (int i = 0; i < g->n; i++)
+    {
+        if (mad == 0 || fabs(v[i] - med) <= opt_k * 1.4826 * mad)
+            v[n++] = v[i];
+    }
+    st->rejected = g->n - n;
+    st->n = n;
+    st->kept = v;
+    st->median = median_sorted(v, n);
+    for (int i = 0; i < n; i++)
+        dev[i] = fabs(v[i] - st->median);
+    st->mad = median_of(dev, n);
+
+    double *boot = (double *)malloc(opt_resamples * sizeof(double));
+    double *rs = (double *)malloc(n * sizeof(double));
+    if (boot == NULL || rs == NULL)
+    {
+        dbprintlf(FATAL "Out of memory.");
+        exit(4);
+    }
+    for (int b = 0; b < opt_resamples; b++)
+    {
+        for (int i = 0; i < n; i++)
+            rs[i] = v[rng_next() % n];
+        boot[b] = median_of(rs, n);
+    }
+    qsort(boot, opt_resamples, sizeof(double), cmp_double);
+    st->lo = boot[(int)(opt_alpha / 2 * (opt_resamples - 1))];
+    st->hi = boot[(int)((1 - opt_alpha / 2) * (opt_resamples - 1))];
+    free(rs);
+    free(boot);
+    free(dev);
+}
+
+/**
+ * @brief Two-sided Mann-Whitney U test with the normal approximation and a
+ * tie correction.
+ *
+ * @return The p-value; z receives the standardized statistic, positive
+ * when a tends to be larger than b.
+ */
+static double mann_whitney(const double *a, int na, const double *b, int nb, double *z)
+{
+    int n = na + nb;
+    struct ranked *all = (struct ranked *)malloc(n * sizeof(struct ranked));
+    double *rank = (double *)malloc(n * sizeof(double));
+    if (all == NULL || rank == NULL)
+    {
+        dbprintlf(FATAL "Out of memory.");
+        exit(4);
+    }
+    for (int i = 0; i < na; i++)
+    {
+        all[i].v = a[i];
+        all[i].from_a = 1;
+    }
+    for (int i = 0; i < nb; i++)
+    {
+        all[na + i].v = b[i];
+        all[na + i].from_a = 0;
+    }
+    qsort(all, n, sizeof(struct ranked), cmp_ranked);
+
+    double ra = 0, ties = 0;
+    for (int i = 0; i < n;)
+    {
+        int j = i;
+        while (j + 1 < n && all[j + 1].v == all[i].v)
+            j++;
+        double t = j - i + 1;
+        ties += t * t * t - t;
+        for (int k = i; k <= j; k++)
+            rank[k] = (i + j) / 2.0 + 1;
+        i = j + 1;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        if (all[i].from_a)
+            ra += rank[i];
+    }
+    free(rank);
+    free(all);
+
+    double u = ra - na * (na + 1) / 2.0;
+    double mu = na * (double)nb / 2;
+    double sigma = sqrt(na * (double)nb / 12 * ((n + 1) - ties / (n * (double)(n - 1))));
+    *z = sigma > 0 ? (u - mu) / sigma : 0;
+    return sigma > 0 ? erfc(fabs(*z) / sqrt(2)) : 1;
+}
+
+/**
+ * @brief Finds a case by its full name, else by a unique prefix, else by a
+ * unique substring.
+ */
+static const struct group *group_find(const char *label)
+{
+    for (int i = 0; i < ngroups; i++)
+    {
+        if (strcmp(groups[i].label, label) == 0)
+            return &groups[i];
+    }
+    for (int prefix = 1; prefix >= 0; prefix--)
+    {
+        const struct group *found = NULL;
+        for (int i = 0; i < ngroups; i++)
+        {
+            const char *at = strstr(groups[i].label, label);
+            if (at == NULL || (prefix && at != groups[i].label))
+                continue;
+            if (found != NULL)
+            {
+                dbprintlf(RED_FG "\"%s\" matches more than one case, e.g. \"%s\" and \"%s\".", label, found->label, groups[i].label);
+                return NULL;
+            }
+            found = &groups[i];
+        }
+        if (found != NULL)
+            return found;
+    }
+    dbprintlf(RED_FG "No case matches \"%s\".", label);
+    return NULL;
+}
+
+static void compare(const char *la, const char *lb)
+{
+    const struct group *ga = group_find(la), *gb = group_find(lb);
+    if (ga == NULL || gb == NULL)
+        return;
+    struct stats a, b;
+    stats_compute(ga, &a);
+    stats_compute(gb, &b);
+    if (a.n < 2 || b.n < 2)
+    {
+        dbprintlf(RED_FG "Not enough trials to compare \"%s\" and \"%s\".", ga->label, gb->label);
+        free(a.kept);
+        free(b.kept);
+        return;
+    }
+
+    double *ra = (double *)malloc(a.n * sizeof(double)), *rb = (double *)malloc(b.n * sizeof(double));
+    double *ratio = (double *)malloc(opt_resamples * sizeof(double));
+    if (ra == NULL || rb == NULL || ratio == NULL)
+    {
+        dbprintlf(FATAL "Out of memory.");
+        exit(4);
+    }
+    for (int r = 0; r < opt_resamples; r++)
+    {
+        for (int i = 0; i < a.n; i++)
+            ra[i] = a.kept[rng_next() % a.n];
+        for (int i = 0; i < b.n; i++)
+            rb[i] = b.kept[rng_next() % b.n];
+        ratio[r] = median_of(ra, a.n) / median_of(rb, b.n);
+    }
+    qsort(ratio, opt_resamples, sizeof(double), cmp_double);
+    double lo = ratio[(int)(opt_alpha / 2 * (opt_resamples - 1))];
+    double hi = ratio[(int)((1 - opt_alpha / 2) * (opt_resamples - 1))];
+    double z, p = mann_whitney(a.kept, a.n, b.kept, b.n, &z);
+
+    const char *verdict;
+    if (p < opt_alpha && lo > 1)
+        verdict = GREEN_FG "A beats B";
+    else if (p < opt_alpha && hi < 1)
+        verdict = RED_FG "B beats A";
+    else
+        verdict = YELLOW_FG "no significant difference";
+
+    printf("A: %s (n=%d)\nB: %s (n=%d)\n", ga->label, a.n, gb->label, b.n);
+    printf("  median A/B %.4f, %.0f%% CI [%.4f, %.4f], Mann-Whitney z %.2f, p %.3g: ",
+           a.median / b.median, (1 - opt_alpha) * 100, lo, hi, z, p);
+    bprintlf("%s", verdict);
+    if (a.n < 8 || b.n < 8)
+        printf("  fewer than 8 trials on a side, the normal approximation behind p is rough\n");
+
+    free(ratio);
+    free(rb);
+    free(ra);
+    free(a.kept);
+    free(b.kept);
+}
+
+static void usage(void)
+{
+    printf("Usage: benchstat.out [-w WARMUP] [-k K] [-b RESAMPLES] [-a ALPHA] [-g N] [-s SEED] [-c A B]... FILE...\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *cmp[MAX_COMPARE][2];
+    int ncmp = 0, run = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] == '-' && argv[i][1] != '\0' && argv[i][2] == '\0')
+        {
+            char opt = argv[i][1];
+            int need = opt == 'c' ? 2 : 1;
+            if (i + need >= argc)
+            {
+                usage();
+                return 1;
+            }
+            switch (opt)
+            {
+            case 'w':
+                opt_warmup = atoi(argv[++i]);
+                break;
+            case 'k':
+                opt_k = atof(argv[++i]);
+                break;
+            case 'b':
+                opt_resamples = atoi(argv[++i]) > 0 ? atoi(argv[i]) : 1;
+                break;
+            case 'a':
+                opt_alpha = atof(argv[++i]);
+                break;
+            case 'g':
+                opt_split = atoi(argv[++i]);
+                break;
+            case 's':
+                rng_state = strtoull(argv[++i], NULL, 0) | 1;
+                break;
+            case 'c':
+                if (ncmp < MAX_COMPARE)
+                {
+                    cmp[ncmp][0] = argv[i + 1];
+                    cmp[ncmp][1] = argv[i + 2];
+                    ncmp++;
+                }
+                i += 2;
+                break;
+            default:
+                usage();
+                return 1;
+            }
+            continue;
+        }
+
+        const char *ext = strrchr(argv[i], '.');
+        int ret = ext != NULL && strcmp(ext, ".bench") == 0 ? load_bench(argv[i], run) : load_data(argv[i], run);
+        if (ret != 0)
+            dbprintlf(RED_FG "Failed to read %s.", argv[i]);
+        run++;
+    }
+    if (run == 0)
+    {
+        usage();
+        return 1;
+    }
+
+    printf("%-48s %5s %5s %5s %14s %8s %31s\n", "case", "n", "warm", "out", "median/s", "MAD %", "CI of median");
+    for (int i = 0; i < ngroups; i++)
+    {
+        struct stats st;
+        stats_compute(&groups[i], &st);
+        printf("%-48s %5d %5d %5d %14.0f %7.2f%% [%14.0f, %14.0f]\n", groups[i].label, st.n, groups[i].warm, st.rejected,
+               st.median, st.median > 0 ? st.mad / st.median * 100 : 0, st.lo, st.hi);
+        free(st.kept);
+    }
+    for (int i = 0; i < ncmp; i++)
+    {
+        printf("\n");
+        compare(cmp[i][0], cmp[i][1]);
+    }
+
+    for (int i = 0; i < ngroups; i++)
+        free(groups[i].v);
+    free(groups);
+    return 0;
+}
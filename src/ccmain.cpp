@@ -23,214 +23,197 @@
  * 
  */
 
-#include <time.h>
-#include "meb_print.h"
-#include <stdlib.h>
-#include <pthread.h>
-#include <unistd.h>
-#include <signal.h>
-#include <inttypes.h>
-#include <limits.h>
-
-#define TRIG_TIMEOUT 1
-#define TRIALS 32
-
-volatile sig_atomic_t done = 0;
-volatile sig_atomic_t ready = 0;
-
-void get_current_fname(char *ret)
+#include "bench.h"
+#include "bench_locks.h"
+
+#define BENCH_LOCK mtx_default
+#define BENCH_LOCK_T pthread_mutex_t
+#define BENCH_LOCK_TIMED
+#include "bench_case.h"
+
+#define BENCH_LOCK mtx_adaptive
+#define BENCH_LOCK_T pthread_mutex_t
+#define BENCH_LOCK_TIMED
+#include "bench_case.h"
+
+#define BENCH_LOCK mtx_recursive
+#define BENCH_LOCK_T pthread_mutex_t
+#define BENCH_LOCK_RECURSIVE
+#define BENCH_LOCK_TIMED
+#include "bench_case.h"
+
+#define BENCH_LOCK owner_mutex
+#define BENCH_LOCK_T owner_mutex_t
+#define BENCH_LOCK_RECURSIVE
+#include "bench_case.h"
+
+#define BENCH_LOCK mtx_pshared
+#define BENCH_LOCK_T pthread_mutex_t
+#define BENCH_LOCK_PSHARED
+#include "bench_case.h"
+
+#define BENCH_LOCK tas
+#define BENCH_LOCK_T tas_lock_t
+#define BENCH_LOCK_PSHARED
+#include "bench_case.h"
+
+#define BENCH_LOCK ttas
+#define BENCH_LOCK_T ttas_lock_t
+#define BENCH_LOCK_PSHARED
+#include "bench_case.h"
+
+#define BENCH_LOCK ticket
+#define BENCH_LOCK_T ticket_lock_t
+#define BENCH_LOCK_FIFO
+#define BENCH_LOCK_PSHARED
+#include "bench_case.h"
+
+#define BENCH_LOCK mcs_mutex
+#define BENCH_LOCK_T mcs_lock_t
+#define BENCH_LOCK_FIFO
+#include "bench_case.h"
+
+#define BENCH_LOCK clh_mutex
+#define BENCH_LOCK_T clh_lock_t
+#define BENCH_LOCK_FIFO
+#include "bench_case.h"
+
+#define BENCH_LOCK rw_default
+#define BENCH_LOCK_T pthread_rwlock_t
+#include "bench_rw_case.h"
+
+#define BENCH_LOCK rw_writer
+#define BENCH_LOCK_T pthread_rwlock_t
+#include "bench_rw_case.h"
+
+#define BENCH_LOCK seqlock
+#define BENCH_LOCK_T seqlock_t
+#define BENCH_RW_OPTIMISTIC
+#include "bench_rw_case.h"
+
+#include "bench_futex.h"
+#include "bench_mutex.h"
+#include "bench_atomic.h"
+
+#define BENCH_LOCK cond_var
+#define BENCH_LOCK_T struct bench_cond
+#define BENCH_WAKE_TOKENS
+#define BENCH_WAKE_BCAST
+#include "bench_wake_case.h"
+
+#define BENCH_LOCK posix_sem
+#define BENCH_LOCK_T sem_t
+#define BENCH_WAKE_TOKENS
+#include "bench_wake_case.h"
+
+int main(int argc, char *argv[])
 {
-    if (ret == NULL)
-        return;
-    char *tmp = (char *)malloc(strlen(__FILE__) + 1);
-    if (tmp == NULL)
-        return;
-    strcpy(tmp, __FILE__);
-    char *tok = strtok(tmp, "/");
-    dbprintlf("%s", tok);
-    while (tok != NULL)
-    {
-        strcpy(ret, tok);
-        tok = strtok(NULL, "/");
-    }
-    free(tmp);
-}
+    bench_init(argc, argv, __FILE__);
 
-void timespec_diff(struct timespec *start, struct timespec *stop,
-                   struct timespec *result)
-{
-    if ((stop->tv_nsec - start->tv_nsec) < 0)
-    {
-        result->tv_sec = stop->tv_sec - start->tv_sec - 1;
-        result->tv_nsec = stop->tv_nsec - start->tv_nsec + 1000000000L;
-    }
-    else
-    {
-        result->tv_sec = stop->tv_sec - start->tv_sec;
-        result->tv_nsec = stop->tv_nsec - start->tv_nsec;
-    }
-
-    return;
-}
-
-void *thread_fcn_rl(void *_mutex) // remote lock, on both recurse and non recurse mutex
-{
-    FILE *fp = fopen("ccmain_rl.data", "a");
-    if (fp == NULL)
-    {
-        dbprintlf(FATAL "Failed to open file.");
-        exit(1);
-    }
+    // CASE 1
+    dbprintlf(UNDER_ON "CASE ONE");
+    struct bench_rate ref = bench_rl_mtx_default("PTHREAD_MUTEX_DEFAULT");
+    bench_rl_tas("TAS");
+    bench_rl_ttas("TTAS");
+    bench_rl_ticket("TICKET");
+    bench_rl_mcs_mutex("MCS");
+    bench_rl_clh_mutex("CLH");
+
+    // CASE 2
+    dbprintlf(UNDER_ON "CASE TWO");
+    bench_rl_mtx_recursive("PTHREAD_MUTEX_RECURSIVE");
+    bench_rl_owner_mutex("OWNER_MUTEX");
 
-    uint64_t count = 0;
-    struct timespec start, end, diff;
-    pthread_mutex_t *mutex = (pthread_mutex_t *)_mutex;
-    if (mutex == NULL)
-    {
-        done = 1;
-        return NULL;
-    }
-    ready = 1; // indicate main thread that we are ready to proceed
-    // here, main thread will lock the mutex
-    while (ready)
-        ;                                  // wait until main thread unsets ready
-    clock_gettime(CLOCK_REALTIME, &start); // get current time
-    while (!done)                          // keep going until main stops you
+    // CASE 3
+    if (!bench_cfg.sweep)
     {
-        pthread_mutex_trylock(mutex);
-        count++;
+        dbprintlf(UNDER_ON "CASE THREE");
+        bench_sl_mtx_recursive("PTHREAD_MUTEX_RECURSIVE");
+        bench_sl_owner_mutex("OWNER_MUTEX");
+        bench_depth_mtx_recursive("PTHREAD_MUTEX_RECURSIVE");
+        bench_depth_owner_mutex("OWNER_MUTEX");
+
+        // CASE 4
+        dbprintlf(UNDER_ON "CASE FOUR");
+        bench_ul_mtx_default("PTHREAD_MUTEX_DEFAULT");
+        bench_ul_mtx_adaptive("PTHREAD_MUTEX_ADAPTIVE_NP");
+        bench_ul_fmtx("FUTEX");
+        bench_ul_tas("TAS");
+        bench_ul_ttas("TTAS");
+        bench_ul_ticket("TICKET");
+        bench_ul_mcs_mutex("MCS");
+        bench_ul_clh_mutex("CLH");
     }
-    clock_gettime(CLOCK_REALTIME, &end);
-    timespec_diff(&start, &end, &diff);
-    bprintlf(BLUE_FG "Lock Attempts: %" PRIu64 " in %ld.%09ld s", count, diff.tv_sec, diff.tv_nsec);
-    fprintf(fp, "%ld.%09ld, %" PRIu64 ", %ld.%09ld\n", start.tv_sec, start.tv_nsec, count, diff.tv_sec, diff.tv_nsec);
-    return NULL;
-}
 
-void *thread_fcn_sl(void *_mutex) // self lock, only on recursive
-{
-    FILE *fp_locks = fopen("cmain_sl_locks.data", "a");
-    if (fp_locks == NULL)
-    {
-        dbprintlf(FATAL "Failed to open file.");
-        exit(2);
-    }
-    FILE *fp_unlocks = fopen("cmain_sl_unlocks.data", "a");
-    if (fp_unlocks == NULL)
+    // CASE 5
+    dbprintlf(UNDER_ON "CASE FIVE");
+    bench_cl_mtx_default("PTHREAD_MUTEX_DEFAULT");
+    bench_cl_mtx_adaptive("PTHREAD_MUTEX_ADAPTIVE_NP");
+    if (bench_cfg.sweep)
+        bench_cl_fmtx("FUTEX");
+    else
+        bench_futex_spin_sweep();
+    bench_cl_tas("TAS");
+    bench_cl_ttas("TTAS");
+    bench_cl_ticket("TICKET");
+    bench_cl_mcs_mutex("MCS");
+    bench_cl_clh_mutex("CLH");
+    bench_fair_summary();
+
+    // CASE 6
+    dbprintlf(UNDER_ON "CASE SIX");
+    bench_rw_rw_default("PTHREAD_RWLOCK_DEFAULT");
+    bench_rw_rw_writer("PTHREAD_RWLOCK_PREFER_WRITER");
+    bench_rw_seqlock("SEQLOCK");
+
+    // CASE 7
+    if (!bench_cfg.sweep)
     {
-        dbprintlf(FATAL "Failed to open file.");
-        exit(3);
+        dbprintlf(UNDER_ON "CASE SEVEN");
+        bench_tl_mtx_default("PTHREAD_MUTEX_DEFAULT");
+        bench_tl_mtx_adaptive("PTHREAD_MUTEX_ADAPTIVE_NP");
+        bench_tl_mtx_recursive("PTHREAD_MUTEX_RECURSIVE");
     }
 
-    uint32_t i_ = INT32_MAX / 100, i = i_;
-    struct timespec start, end, diff;
-    pthread_mutex_t *mutex = (pthread_mutex_t *)_mutex;
-    if (mutex == NULL)
-    {
-        done = 1;
-        return NULL;
-    }
-    pthread_mutex_lock(mutex);             // lock your recursive mutex
-    clock_gettime(CLOCK_REALTIME, &start); // get current time
-    while (i--)                            // keep going until main stops you
-    {
-        pthread_mutex_trylock(mutex);
-    }
-    clock_gettime(CLOCK_REALTIME, &end);
-    timespec_diff(&start, &end, &diff);
-    bprintlf(BLUE_FG "Lock Attempts: %" PRIu32 " in %ld.%09ld s", i_, diff.tv_sec, diff.tv_nsec);
-    fprintf(fp_locks, "%ld.%09ld, %" PRIu64 ", %ld.%09ld\n", start.tv_sec, start.tv_nsec, i_, diff.tv_sec, diff.tv_nsec);
-
-    i = i_;
-    clock_gettime(CLOCK_REALTIME, &start); // get current time
-    while (i--)
+    // CASE 8
+    dbprintlf(UNDER_ON "CASE EIGHT");
+    bench_pp_mtx_default("PTHREAD_MUTEX_DEFAULT");
+    bench_pp_mtx_adaptive("PTHREAD_MUTEX_ADAPTIVE_NP");
+    bench_pp_fmtx("FUTEX");
+    bench_pp_tas("TAS");
+    bench_pp_ttas("TTAS");
+    bench_pp_ticket("TICKET");
+    bench_pp_mcs_mutex("MCS");
+    bench_pp_clh_mutex("CLH");
+
+    // CASE 9
+    if (!bench_cfg.sweep)
     {
-        pthread_mutex_unlock(mutex);
+        dbprintlf(UNDER_ON "CASE NINE");
+        bench_mutex_matrix();
     }
-    pthread_mutex_unlock(mutex);
-    clock_gettime(CLOCK_REALTIME, &end);
-    timespec_diff(&start, &end, &diff);
-    bprintlf(BLUE_FG "Unlock Attempts: %" PRIu32 " in %ld.%09ld s", i_, diff.tv_sec, diff.tv_nsec);
-    fprintf(fp_unlocks, "%ld.%09ld, %" PRIu64 ", %ld.%09ld\n", start.tv_sec, start.tv_nsec, i_, diff.tv_sec, diff.tv_nsec);
-    return NULL;
-}
-
-int main()
-{
-    char fname[512];
-    get_current_fname(fname);
-    bprintlf(GREEN_FG "Program: %s", fname);
-    struct timespec start, stop, result;
-    pthread_mutex_t m;
-    pthread_mutexattr_t attr;
-    pthread_t thread;
-    clock_gettime(CLOCK_REALTIME, &start);
 
-    dbprintlf(UNDER_ON "CASE ONE");
-    for (int i = 0; i < TRIALS; i++)
+    // CASE 10
+    if (bench_cfg.procs)
     {
-        pthread_mutexattr_init(&attr);
-
-        // CASE 1
-        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_DEFAULT);
-        pthread_mutex_init(&m, &attr);
-
-        pthread_create(&thread, NULL, &thread_fcn_rl, &m);
-        while (!ready)
-            ; // wait until slave signals ready
-        pthread_mutex_lock(&m);
-        ready = 0;
-        sleep(TRIG_TIMEOUT);
-        done = 1;
-        pthread_join(thread, NULL);
-        pthread_mutex_unlock(&m);
-        pthread_mutex_destroy(&m);
-
-        ready = 0;
-        done = 0;
+        dbprintlf(UNDER_ON "CASE TEN");
+        bench_xp_mtx_pshared("PTHREAD_PROCESS_SHARED");
+        bench_xp_tas("TAS");
+        bench_xp_ttas("TTAS");
+        bench_xp_ticket("TICKET");
     }
 
-    dbprintlf(UNDER_ON "CASE TWO");
-    for (int i = 0; i < TRIALS; i++)
-    {
-        // CASE 2
-        done = 0;
-        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
-        pthread_mutex_init(&m, &attr);
-
-        pthread_create(&thread, NULL, &thread_fcn_rl, &m);
-        while (!ready)
-            ; // wait until slave signals ready
-        pthread_mutex_lock(&m);
-        ready = 0;
-        sleep(TRIG_TIMEOUT);
-        done = 1;
-        pthread_join(thread, NULL);
-        pthread_mutex_unlock(&m);
-        pthread_mutex_destroy(&m);
-        ready = 0;
-        done = 0;
-    }
+    // CASE 11
+    dbprintlf(UNDER_ON "CASE ELEVEN");
+    bench_atomic_baseline("PTHREAD_MUTEX_DEFAULT", ref.ops);
 
-    // CASE 3
-    dbprintlf(UNDER_ON "CASE THREE");
-    for (int i = 0; i < TRIALS; i++)
-    {
-        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
-        pthread_mutex_init(&m, &attr);
-
-        pthread_create(&thread, NULL, &thread_fcn_sl, &m);
-        pthread_join(thread, NULL);
-        pthread_mutex_destroy(&m);
-        ready = 0;
-        done = 0;
-    }
+    // CASE 12
+    dbprintlf(UNDER_ON "CASE TWELVE");
+    bench_wake_cond_var("PTHREAD_COND");
+    bench_wake_posix_sem("SEM");
+    bench_wake_summary();
 
     // CLEANUP
 
-    clock_gettime(CLOCK_REALTIME, &stop);
-    timespec_diff(&start, &stop, &result);
-    bprintlf(BLUE_FG "[%s] Program Elapsed Time: %ld.%09ld ", fname, result.tv_sec, result.tv_nsec);
-
-    return 0;
-}
\ No newline at end of file
+    return bench_finish();
+}
@@ -23,265 +23,197 @@
  * 
  */
 
-#include <time.h>
-#include "meb_print.h"
-#include <stdlib.h>
-#include <pthread.h>
-#include <unistd.h>
-#include <signal.h>
-#include <inttypes.h>
-#include <limits.h>
-#include <string.h>
-
-#define TRIG_TIMEOUT 1
-#define TRIALS 32
-
-volatile sig_atomic_t done = 0;
-volatile sig_atomic_t ready = 0;
-
-void get_current_fname(char *ret)
+#include "bench.h"
+#include "bench_locks.h"
+
+#define BENCH_LOCK mtx_default
+#define BENCH_LOCK_T pthread_mutex_t
+#define BENCH_LOCK_TIMED
+#include "bench_case.h"
+
+#define BENCH_LOCK mtx_adaptive
+#define BENCH_LOCK_T pthread_mutex_t
+#define BENCH_LOCK_TIMED
+#include "bench_case.h"
+
+#define BENCH_LOCK mtx_recursive
+#define BENCH_LOCK_T pthread_mutex_t
+#define BENCH_LOCK_RECURSIVE
+#define BENCH_LOCK_TIMED
+#include "bench_case.h"
+
+#define BENCH_LOCK owner_mutex
+#define BENCH_LOCK_T owner_mutex_t
+#define BENCH_LOCK_RECURSIVE
+#include "bench_case.h"
+
+#define BENCH_LOCK mtx_pshared
+#define BENCH_LOCK_T pthread_mutex_t
+#define BENCH_LOCK_PSHARED
+#include "bench_case.h"
+
+#define BENCH_LOCK tas
+#define BENCH_LOCK_T tas_lock_t
+#define BENCH_LOCK_PSHARED
+#include "bench_case.h"
+
+#define BENCH_LOCK ttas
+#define BENCH_LOCK_T ttas_lock_t
+#define BENCH_LOCK_PSHARED
+#include "bench_case.h"
+
+#define BENCH_LOCK ticket
+#define BENCH_LOCK_T ticket_lock_t
+#define BENCH_LOCK_FIFO
+#define BENCH_LOCK_PSHARED
+#include "bench_case.h"
+
+#define BENCH_LOCK mcs_mutex
+#define BENCH_LOCK_T mcs_lock_t
+#define BENCH_LOCK_FIFO
+#include "bench_case.h"
+
+#define BENCH_LOCK clh_mutex
+#define BENCH_LOCK_T clh_lock_t
+#define BENCH_LOCK_FIFO
+#include "bench_case.h"
+
+#define BENCH_LOCK rw_default
+#define BENCH_LOCK_T pthread_rwlock_t
+#include "bench_rw_case.h"
+
+#define BENCH_LOCK rw_writer
+#define BENCH_LOCK_T pthread_rwlock_t
+#include "bench_rw_case.h"
+
+#define BENCH_LOCK seqlock
+#define BENCH_LOCK_T seqlock_t
+#define BENCH_RW_OPTIMISTIC
+#include "bench_rw_case.h"
+
+#include "bench_futex.h"
+#include "bench_mutex.h"
+#include "bench_atomic.h"
+
+#define BENCH_LOCK cond_var
+#define BENCH_LOCK_T struct bench_cond
+#define BENCH_WAKE_TOKENS
+#define BENCH_WAKE_BCAST
+#include "bench_wake_case.h"
+
+#define BENCH_LOCK posix_sem
+#define BENCH_LOCK_T sem_t
+#define BENCH_WAKE_TOKENS
+#include "bench_wake_case.h"
+
+int main(int argc, char *argv[])
 {
-    if (ret == NULL)
-        return;
-    char *tmp = (char *)malloc(strlen(__FILE__) + 1);
-    if (tmp == NULL)
-        return;
-    strcpy(tmp, __FILE__);
-    char *tok = strtok(tmp, "/");
-    dbprintlf("%s", tok);
-    while (tok != NULL)
-    {
-        strcpy(ret, tok);
-        tok = strtok(NULL, "/");
-    }
-    free(tmp);
-}
-
-void timespec_diff(struct timespec *start, struct timespec *stop,
-                   struct timespec *result)
-{
-    if ((stop->tv_nsec - start->tv_nsec) < 0)
-    {
-        result->tv_sec = stop->tv_sec - start->tv_sec - 1;
-        result->tv_nsec = stop->tv_nsec - start->tv_nsec + 1000000000L;
-    }
-    else
-    {
-        result->tv_sec = stop->tv_sec - start->tv_sec;
-        result->tv_nsec = stop->tv_nsec - start->tv_nsec;
-    }
+    bench_init(argc, argv, __FILE__);
 
-    return;
-}
-
-void *thread_fcn_rl(void *_mutex) // remote lock, on both recurse and non recurse mutex
-{
-    FILE *fp = fopen("cmain_rl.data", "a");
-    if (fp == NULL)
-    {
-        dbprintlf(FATAL "Failed to open file.");
-        exit(1);
-    }
+    // CASE 1
+    dbprintlf(UNDER_ON "CASE ONE");
+    struct bench_rate ref = bench_rl_mtx_default("PTHREAD_MUTEX_DEFAULT");
+    bench_rl_tas("TAS");
+    bench_rl_ttas("TTAS");
+    bench_rl_ticket("TICKET");
+    bench_rl_mcs_mutex("MCS");
+    bench_rl_clh_mutex("CLH");
 
-    uint64_t count = 0;
-    struct timespec start, end, diff;
-    pthread_mutex_t *mutex = (pthread_mutex_t *)_mutex;
-    if (mutex == NULL)
-    {
-        done = 1;
-        return NULL;
-    }
-    ready = 1; // indicate main thread that we are ready to proceed
-    // here, main thread will lock the mutex
-    while (ready)
-        ;                                  // wait until main thread unsets ready
-
-    // long total_sec = 0;
-    // long total_nsec = 0;
-    // unsigned long long total_unlocks = 0;
-    // for (int i = 0; i < TRIALS; i++)
-    // {
-        clock_gettime(CLOCK_REALTIME, &start); // get current time
-        while (!done)                          // keep going until main stops you
-        {
-            pthread_mutex_trylock(mutex);
-            count++;
-        }
-        clock_gettime(CLOCK_REALTIME, &end);
-        timespec_diff(&start, &end, &diff);
-        bprintlf(BLUE_FG "Lock Attempts: %" PRIu64 " in %ld.%09ld s", count, diff.tv_sec, diff.tv_nsec);
-
-        fprintf(fp, "%ld.%09ld, %" PRIu64 ", %ld.%09ld\n", start.tv_sec, start.tv_nsec, count, diff.tv_sec, diff.tv_nsec);
-
-        // total_sec += diff.tv_sec;
-        // total_nsec += diff.tv_nsec; 
-        // total_unlocks += count;
-    // }
-
-    // bprintlf(RED_FG "TOTALS~");
-    // bprintlf(RED_FG "Unlock Attempts: %llu in %ld.%09ld s", total_unlocks, total_sec, total_nsec);
-
-    return NULL;
-}
+    // CASE 2
+    dbprintlf(UNDER_ON "CASE TWO");
+    bench_rl_mtx_recursive("PTHREAD_MUTEX_RECURSIVE");
+    bench_rl_owner_mutex("OWNER_MUTEX");
 
-void *thread_fcn_sl(void *_mutex) // self lock, only on recursive
-{
-    FILE *fp_locks = fopen("cmain_sl_locks.data", "a");
-    if (fp_locks == NULL)
-    {
-        dbprintlf(FATAL "Failed to open file.");
-        exit(2);
-    }
-    FILE *fp_unlocks = fopen("cmain_sl_unlocks.data", "a");
-    if (fp_unlocks == NULL)
+    // CASE 3
+    if (!bench_cfg.sweep)
     {
-        dbprintlf(FATAL "Failed to open file.");
-        exit(3);
+        dbprintlf(UNDER_ON "CASE THREE");
+        bench_sl_mtx_recursive("PTHREAD_MUTEX_RECURSIVE");
+        bench_sl_owner_mutex("OWNER_MUTEX");
+        bench_depth_mtx_recursive("PTHREAD_MUTEX_RECURSIVE");
+        bench_depth_owner_mutex("OWNER_MUTEX");
+
+        // CASE 4
+        dbprintlf(UNDER_ON "CASE FOUR");
+        bench_ul_mtx_default("PTHREAD_MUTEX_DEFAULT");
+        bench_ul_mtx_adaptive("PTHREAD_MUTEX_ADAPTIVE_NP");
+        bench_ul_fmtx("FUTEX");
+        bench_ul_tas("TAS");
+        bench_ul_ttas("TTAS");
+        bench_ul_ticket("TICKET");
+        bench_ul_mcs_mutex("MCS");
+        bench_ul_clh_mutex("CLH");
     }
 
-    uint32_t i_, i;
-    i_ = i = INT_MAX / 1000;
-    struct timespec start, end, diff;
-    pthread_mutex_t *mutex = (pthread_mutex_t *)_mutex;
-    if (mutex == NULL)
+    // CASE 5
+    dbprintlf(UNDER_ON "CASE FIVE");
+    bench_cl_mtx_default("PTHREAD_MUTEX_DEFAULT");
+    bench_cl_mtx_adaptive("PTHREAD_MUTEX_ADAPTIVE_NP");
+    if (bench_cfg.sweep)
+        bench_cl_fmtx("FUTEX");
+    else
+        bench_futex_spin_sweep();
+    bench_cl_tas("TAS");
+    bench_cl_ttas("TTAS");
+    bench_cl_ticket("TICKET");
+    bench_cl_mcs_mutex("MCS");
+    bench_cl_clh_mutex("CLH");
+    bench_fair_summary();
+
+    // CASE 6
+    dbprintlf(UNDER_ON "CASE SIX");
+    bench_rw_rw_default("PTHREAD_RWLOCK_DEFAULT");
+    bench_rw_rw_writer("PTHREAD_RWLOCK_PREFER_WRITER");
+    bench_rw_seqlock("SEQLOCK");
+
+    // CASE 7
+    if (!bench_cfg.sweep)
     {
-        done = 1;
-        return NULL;
+        dbprintlf(UNDER_ON "CASE SEVEN");
+        bench_tl_mtx_default("PTHREAD_MUTEX_DEFAULT");
+        bench_tl_mtx_adaptive("PTHREAD_MUTEX_ADAPTIVE_NP");
+        bench_tl_mtx_recursive("PTHREAD_MUTEX_RECURSIVE");
     }
-    pthread_mutex_lock(mutex); // lock your recursive mutex
-    // dbprintlf();
-
-    // long ul_total_sec = 0;
-    // long ul_total_nsec = 0;
-    // unsigned long long total_unlocks = 0;
-    // long l_total_sec = 0;
-    // long l_total_nsec = 0;
-    // unsigned long long total_locks = 0;
-    // for (int idx = 0; idx < TRIALS; idx++)
-    // {
-        clock_gettime(CLOCK_REALTIME, &start); // get current time
-        while (i--)                            // keep going until main stops you
-        {
-            pthread_mutex_trylock(mutex);
-        }
-        clock_gettime(CLOCK_REALTIME, &end);
-        timespec_diff(&start, &end, &diff);
-        bprintlf(BLUE_FG "Lock Attempts: %" PRIu32 " in %ld.%09ld s", i_, diff.tv_sec, diff.tv_nsec);
-
-        fprintf(fp_locks, "%ld.%09ld, %" PRIu64 ", %ld.%09ld\n", start.tv_sec, start.tv_nsec, i_, diff.tv_sec, diff.tv_nsec);
-
-        // l_total_sec += diff.tv_sec;
-        // l_total_nsec += diff.tv_nsec; 
-        // total_locks += i_;
-
-        i = i_;
-        clock_gettime(CLOCK_REALTIME, &start); // get current time
-        while (i--)
-        {
-            pthread_mutex_unlock(mutex);
-        }
-        pthread_mutex_unlock(mutex);
-        clock_gettime(CLOCK_REALTIME, &end);
-        timespec_diff(&start, &end, &diff);
-
-        bprintlf(BLUE_FG "Unlock Attempts: %" PRIu32 " in %ld.%09ld s", i_, diff.tv_sec, diff.tv_nsec);
-
-        fprintf(fp_unlocks, "%ld.%09ld, %" PRIu64 ", %ld.%09ld\n", start.tv_sec, start.tv_nsec, i_, diff.tv_sec, diff.tv_nsec);
-       
-        // ul_total_sec += diff.tv_sec;
-        // ul_total_nsec += diff.tv_nsec; 
-        // total_unlocks += i_;
-    // }
-
-    // bprintlf(RED_FG "TOTALS~");
-    // bprintlf(RED_FG "Lock Attempts: %llu in %ld.%09ld s", total_locks, l_total_sec, l_total_nsec);
-    // bprintlf(RED_FG "Unlock Attempts: %llu in %ld.%09ld s", total_unlocks, ul_total_sec, ul_total_nsec);
-
-    return NULL;
-}
-
-int main()
-{
-    dbprintlf();
-    char fname[512];
-    dbprintlf();
-    get_current_fname(fname);
-    dbprintlf();
-    bprintlf(GREEN_FG "Program: %s", fname);
-    struct timespec start, stop, result;
-    pthread_mutex_t m;
-    pthread_mutexattr_t attr;
-    pthread_t thread;
-    clock_gettime(CLOCK_REALTIME, &start);
-
 
-    dbprintlf(UNDER_ON "CASE ONE");
-    for (int i = 0; i < TRIALS; i++)
+    // CASE 8
+    dbprintlf(UNDER_ON "CASE EIGHT");
+    bench_pp_mtx_default("PTHREAD_MUTEX_DEFAULT");
+    bench_pp_mtx_adaptive("PTHREAD_MUTEX_ADAPTIVE_NP");
+    bench_pp_fmtx("FUTEX");
+    bench_pp_tas("TAS");
+    bench_pp_ttas("TTAS");
+    bench_pp_ticket("TICKET");
+    bench_pp_mcs_mutex("MCS");
+    bench_pp_clh_mutex("CLH");
+
+    // CASE 9
+    if (!bench_cfg.sweep)
     {
-        pthread_mutexattr_init(&attr);
-
-        // CASE 1
-        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_DEFAULT);
-        pthread_mutex_init(&m, &attr);
-
-        pthread_create(&thread, NULL, &thread_fcn_rl, &m);
-        while (!ready)
-            ; // wait until slave signals ready
-        pthread_mutex_lock(&m);
-        ready = 0;
-        sleep(TRIG_TIMEOUT);
-        done = 1; // trigger slave exit
-        pthread_join(thread, NULL);
-        pthread_mutex_unlock(&m);
-        pthread_mutex_destroy(&m);
-
-        done = 0;
-        ready = 0;
+        dbprintlf(UNDER_ON "CASE NINE");
+        bench_mutex_matrix();
     }
 
-    // CASE 2
-    dbprintlf(UNDER_ON "CASE TWO");
-    for (int i = 0; i < TRIALS; i++)
+    // CASE 10
+    if (bench_cfg.procs)
     {
-        done = 0;
-        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
-        pthread_mutex_init(&m, &attr);
-
-        pthread_create(&thread, NULL, &thread_fcn_rl, &m);
-        while (!ready)
-            ; // wait until slave signals ready
-        pthread_mutex_lock(&m);
-        ready = 0;
-        sleep(TRIG_TIMEOUT);
-        done = 1; // trigger slave exit
-        pthread_join(thread, NULL);
-        pthread_mutex_unlock(&m);
-        pthread_mutex_destroy(&m);
-
-        done = 0;
-        ready = 0;
+        dbprintlf(UNDER_ON "CASE TEN");
+        bench_xp_mtx_pshared("PTHREAD_PROCESS_SHARED");
+        bench_xp_tas("TAS");
+        bench_xp_ttas("TTAS");
+        bench_xp_ticket("TICKET");
     }
 
-    // CASE 3
-    dbprintlf(UNDER_ON "CASE THREE");
-    for (int i = 0; i < TRIALS; i++)
-    {
-        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
-        pthread_mutex_init(&m, &attr);
+    // CASE 11
+    dbprintlf(UNDER_ON "CASE ELEVEN");
+    bench_atomic_baseline("PTHREAD_MUTEX_DEFAULT", ref.ops);
 
-        pthread_create(&thread, NULL, &thread_fcn_sl, &m);
-        pthread_join(thread, NULL);
-        pthread_mutex_destroy(&m);
-
-        done = 0;
-        ready = 0;
-    }
+    // CASE 12
+    dbprintlf(UNDER_ON "CASE TWELVE");
+    bench_wake_cond_var("PTHREAD_COND");
+    bench_wake_posix_sem("SEM");
+    bench_wake_summary();
 
     // CLEANUP
 
-    clock_gettime(CLOCK_REALTIME, &stop);
-    timespec_diff(&start, &stop, &result);
-    bprintlf(BLUE_FG "[%s] Program Elapsed Time: %ld.%09ld ", fname, result.tv_sec, result.tv_nsec);
-
-    return 0;
-}
\ No newline at end of file
+    return bench_finish();
+}
@@ -23,181 +23,156 @@
  * 
  */
 
-#include <time.h>
-#include "meb_print.h"
-#include <stdlib.h>
-#include <pthread.h>
-#include <unistd.h>
-#include <signal.h>
-#include <inttypes.h>
-#include <limits.h>
+#include "bench.h"
+#include "bench_locks.h"
 
 #include <thread>
 #include <mutex>
-
-#define TRIG_TIMEOUT 1
-#define TRIALS 4
-
-volatile sig_atomic_t done = 0;
-volatile sig_atomic_t ready = 0;
-
-void get_current_fname(char *ret)
+#include <shared_mutex>
+
+#define BENCH_LOCK std_mutex
+#define BENCH_LOCK_T std::mutex
+#include "bench_case.h"
+
+#define BENCH_LOCK std_recursive_mutex
+#define BENCH_LOCK_T std::recursive_mutex
+#define BENCH_LOCK_RECURSIVE
+#include "bench_case.h"
+
+#define BENCH_LOCK mtx_recursive
+#define BENCH_LOCK_T pthread_mutex_t
+#define BENCH_LOCK_RECURSIVE
+#include "bench_case.h"
+
+#define BENCH_LOCK owner_mutex
+#define BENCH_LOCK_T owner_mutex_t
+#define BENCH_LOCK_RECURSIVE
+#include "bench_case.h"
+
+#define BENCH_LOCK std_timed_mutex
+#define BENCH_LOCK_T std::timed_mutex
+#define BENCH_LOCK_TIMED
+#include "bench_case.h"
+
+#define BENCH_LOCK std_recursive_timed_mutex
+#define BENCH_LOCK_T std::recursive_timed_mutex
+#define BENCH_LOCK_RECURSIVE
+#define BENCH_LOCK_TIMED
+#include "bench_case.h"
+
+#define BENCH_LOCK std_shared_mutex
+#define BENCH_LOCK_T std::shared_mutex
+#include "bench_rw_case.h"
+
+#define BENCH_ATOMIC_STD
+#include "bench_atomic.h"
+
+#define BENCH_LOCK std_cv
+#define BENCH_LOCK_T struct bench_std_cv
+#define BENCH_WAKE_TOKENS
+#define BENCH_WAKE_BCAST
+#include "bench_wake_case.h"
+
+#ifdef __cpp_lib_semaphore
+#define BENCH_LOCK std_sem
+#define BENCH_LOCK_T struct bench_std_sem
+#define BENCH_WAKE_TOKENS
+#include "bench_wake_case.h"
+#endif
+
+#ifdef __cpp_lib_atomic_wait
+#define BENCH_LOCK std_wait
+#define BENCH_LOCK_T struct bench_std_wait
+#define BENCH_WAKE_TOKENS
+#define BENCH_WAKE_BCAST
+#include "bench_wake_case.h"
+#endif
+
+#ifdef __cpp_lib_latch
+#define BENCH_LOCK std_latch
+#define BENCH_LOCK_T struct bench_std_latch
+#define BENCH_WAKE_BCAST
+#include "bench_wake_case.h"
+#endif
+
+#ifdef __cpp_lib_barrier
+#define BENCH_LOCK std_barrier
+#define BENCH_LOCK_T struct bench_std_barrier
+#define BENCH_WAKE_BCAST
+#include "bench_wake_case.h"
+#endif
+
+int main(int argc, char *argv[])
 {
-    if (ret == NULL)
-        return;
-    char *tmp = (char *) malloc(strlen(__FILE__) + 1);
-    if (tmp == NULL)
-        return;
-    strcpy(tmp, __FILE__);
-    char *tok = strtok(tmp, "/");
-    dbprintlf("%s", tok);
-    while (tok != NULL)
-    {
-        strcpy(ret, tok);
-        tok = strtok(NULL, "/");
-    }
-    free(tmp);
-}
+    bench_init(argc, argv, __FILE__);
 
-void timespec_diff(struct timespec *start, struct timespec *stop,
-                   struct timespec *result)
-{
-    if ((stop->tv_nsec - start->tv_nsec) < 0)
-    {
-        result->tv_sec = stop->tv_sec - start->tv_sec - 1;
-        result->tv_nsec = stop->tv_nsec - start->tv_nsec + 1000000000L;
-    }
-    else
-    {
-        result->tv_sec = stop->tv_sec - start->tv_sec;
-        result->tv_nsec = stop->tv_nsec - start->tv_nsec;
-    }
-
-    return;
-}
-
-void thread_fcn_rl(std::mutex &mutex) // remote lock, on both recurse and non recurse mutex
-{
-    uint64_t count = 0;
-    struct timespec start, end, diff;
-    ready = 1; // indicate main thread that we are ready to proceed
-    // here, main thread will lock the mutex
-    while (ready); // wait until main thread unsets ready
-    clock_gettime(CLOCK_REALTIME, &start); // get current time
-    while (!done) // keep going until main stops you
-    {
-        mutex.try_lock();
-        count++;
-        // dbprintlf("Count: %d", count);
-    }
-    clock_gettime(CLOCK_REALTIME, &end);
-    timespec_diff(&start, &end, &diff);
-    bprintlf(BLUE_FG "Lock Attempts: %" PRIu64 " in %ld.%09ld s", count, diff.tv_sec, diff.tv_nsec);
-    return;
-}
+    // CASE 1
+    dbprintlf(UNDER_ON "CASE ONE");
+    struct bench_rate ref = bench_rl_std_mutex("std::mutex");
 
-void thread_fcn_rlr(std::recursive_mutex &mutex) // remote lock, on both recurse and non recurse mutex
-{
-    uint64_t count = 0;
-    struct timespec start, end, diff;
-    ready = 1; // indicate main thread that we are ready to proceed
-    // here, main thread will lock the mutex
-    while (ready); // wait until main thread unsets ready
-    clock_gettime(CLOCK_REALTIME, &start); // get current time
-    while (!done) // keep going until main stops you
-    {
-        /* bool retval =  */mutex.try_lock();
-        count++;
-        // dbprintlf("Retval: %s (%d); Count: %d", retval ? "True" : "False", retval, count);
-    }
-    clock_gettime(CLOCK_REALTIME, &end);
-    timespec_diff(&start, &end, &diff);
-    bprintlf(BLUE_FG "Lock Attempts: %" PRIu64 " in %ld.%09ld s", count, diff.tv_sec, diff.tv_nsec);
-    return;
-}
+    // CASE 2
+    dbprintlf(UNDER_ON "CASE TWO");
+    bench_rl_std_recursive_mutex("std::recursive_mutex");
 
-void thread_fcn_sl(std::recursive_mutex &mutex) // self lock, only on recursive
-{
-    uint32_t i_ = INT32_MAX / 100, i = i_;
-    struct timespec start, end, diff;
-    mutex.lock();
-    clock_gettime(CLOCK_REALTIME, &start); // get current time
-    while (i--) // keep going until main stops you
-    {
-        mutex.try_lock();
-    }
-    clock_gettime(CLOCK_REALTIME, &end);
-    timespec_diff(&start, &end, &diff);
-    bprintlf(BLUE_FG "Lock Attempts: %" PRIu32 " in %ld.%09ld s", i_, diff.tv_sec, diff.tv_nsec);
-    i = i_;
-    clock_gettime(CLOCK_REALTIME, &start); // get current time
-    while (i--)
+    // CASE 3
+    if (!bench_cfg.sweep)
     {
-        mutex.unlock();
+        dbprintlf(UNDER_ON "CASE THREE");
+        bench_sl_std_recursive_mutex("std::recursive_mutex");
+        bench_depth_std_recursive_mutex("std::recursive_mutex");
+        bench_depth_mtx_recursive("PTHREAD_MUTEX_RECURSIVE");
+        bench_depth_owner_mutex("OWNER_MUTEX");
+
+        // CASE 4
+        dbprintlf(UNDER_ON "CASE FOUR");
+        bench_ul_std_mutex("std::mutex");
     }
-    mutex.unlock();
-    clock_gettime(CLOCK_REALTIME, &end);
-    timespec_diff(&start, &end, &diff);
-    bprintlf(BLUE_FG "Unlock Attempts: %" PRIu32 " in %ld.%09ld s", i_, diff.tv_sec, diff.tv_nsec);
-    return;
-}
 
-int main()
-{
-    char fname[512];
-    get_current_fname(fname);
-    bprintlf(GREEN_FG "Program: %s", fname);
-    struct timespec start, stop, result;
-    clock_gettime(CLOCK_REALTIME, &start);
+    // CASE 5
+    dbprintlf(UNDER_ON "CASE FIVE");
+    bench_cl_std_mutex("std::mutex");
+    bench_cl_std_recursive_mutex("std::recursive_mutex");
+    bench_fair_summary();
 
-    // CASE 1
-    dbprintlf(UNDER_ON "CASE ONE");
-    std::mutex m;
-    for (int i = 0; i < TRIALS; i++)
-    {
-        // dbprintlf(GREEN_FG "Beginning thread.");
-        std::thread thr(thread_fcn_rl, std::ref(m));
-        while (!ready); // wait until slave signals ready
-        // dbprintlf(GREEN_FG "LOCKING.");
-        m.lock();
-        ready = 0;
-        sleep(TRIG_TIMEOUT);
-        done = 1;
-        // dbprintlf(GREEN_FG "JOINING.");
-        thr.join();
-        // dbprintlf(GREEN_FG "UNLOCKING.");
-        m.unlock();
-    }
+    // CASE 6
+    dbprintlf(UNDER_ON "CASE SIX");
+    bench_rw_std_shared_mutex("std::shared_mutex");
 
-    // CASE 3
-    dbprintlf(UNDER_ON "CASE TWO");
-    std::recursive_mutex m_;
-    for (int i = 0; i < TRIALS; i++)
+    // CASE 7
+    if (!bench_cfg.sweep)
     {
-        // CASE 2
-        done = 0;
-        std::thread thr2(thread_fcn_rlr, std::ref(m_));
-        while (!ready); // wait until slave signals ready
-        m_.lock();
-        ready = 0;
-        sleep(TRIG_TIMEOUT);
-        done = 1; // Why wasn't this here before?
-        thr2.join();
-        m_.unlock();        
+        dbprintlf(UNDER_ON "CASE SEVEN");
+        bench_tl_std_timed_mutex("std::timed_mutex");
+        bench_tl_std_recursive_timed_mutex("std::recursive_timed_mutex");
     }
 
-    dbprintlf(UNDER_ON "CASE THREE");
-    for (int i = 0; i < TRIALS; i++)
-    {
-        std::thread thr3(thread_fcn_sl, std::ref(m_));
-        thr3.join();
-    }
+    // CASE 8
+    dbprintlf(UNDER_ON "CASE EIGHT");
+    bench_pp_std_mutex("std::mutex");
+    bench_pp_std_timed_mutex("std::timed_mutex");
+
+    // CASE 11
+    dbprintlf(UNDER_ON "CASE ELEVEN");
+    bench_atomic_baseline("std::mutex", ref.ops);
+
+    // CASE 12
+    dbprintlf(UNDER_ON "CASE TWELVE");
+    bench_wake_std_cv("std::condition_variable");
+#ifdef __cpp_lib_semaphore
+    bench_wake_std_sem("std::counting_semaphore");
+#endif
+#ifdef __cpp_lib_atomic_wait
+    bench_wake_std_wait("std::atomic::wait");
+#endif
+#ifdef __cpp_lib_latch
+    bench_wake_std_latch("std::latch");
+#endif
+#ifdef __cpp_lib_barrier
+    bench_wake_std_barrier("std::barrier");
+#endif
+    bench_wake_summary();
 
     // CLEANUP
 
-    clock_gettime(CLOCK_REALTIME, &stop);
-    timespec_diff(&start, &stop, &result);
-    bprintlf(BLUE_FG "[%s] Program Elapsed Time: %ld.%09ld ", fname, result.tv_sec, result.tv_nsec);
-
-    return 0;
-}
\ No newline at end of file
+    return bench_finish();
+}